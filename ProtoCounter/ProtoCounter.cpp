@@ -34,6 +34,8 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 		defined (__AVR_ATtiny2313A__) || \
 		defined (__AVR_ATtiny4313__)
 #define PROTOCOUNTER_TX13
+#elif	defined (PROTOCOUNTER_HOST)
+// host build with simulated registers (see folder "host")
 #else
 #error "incompatible microcontroller type (must be ATtiny2313 or 4313)"
 #endif
@@ -54,6 +56,14 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #include <util/atomic.h>
 #include "ProtoCounter.h"
 
+#ifdef POWER_MANAGER
+	#include <avr/sleep.h>
+#endif
+
+#ifdef EEPROM_RECORD_SIZE
+	#include <avr/eeprom.h>
+#endif
+
 #ifdef ARDUINO
 	#include "Arduino.h"
 #else
@@ -65,12 +75,280 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
  * macros *
  **********/
 
+#ifdef PROTOCOUNTER_HOST
+#define swap(x)		((uint8_t)(((uint8_t)(x) << 4) | ((uint8_t)(x) >> 4)))
+#else
 #define swap(x)                                            \
  ({                                                        \
     unsigned char __x__ = (unsigned char) x;               \
     asm volatile ("swap %0" : "=r" (__x__) : "0" (__x__)); \
     __x__;                                                 \
   })
+#endif
+
+// analog comparator input AIN1 (PB1)
+#ifndef AIN1_PORT
+#define AIN1_PORT	PORTB
+#define AIN1_DDR	DDRB
+#define AIN1_BIT	1
+#endif
+
+// USI three-wire mode, clocked by software strobe on USCK
+#ifdef SH_REG_USI
+#if (SH_REG_OUT_BIT != 6) || (SH_REG_IN_BIT != 5) || (SH_REG_CLK_BIT != 7)
+#error "SH_REG_USI needs OUT on PB6 (DO), IN on PB5 (DI) and CLK on PB7 (USCK)"
+#endif
+#define USI_CLOCK_STROBE	((1<<USIWM0)|(1<<USICS1)|(1<<USICLK)|(1<<USITC))
+#define SH_REG_USI_OUT_BYTES	((SH_REG_OUT_BITCOUNT + 7) / 8)
+#define SH_REG_USI_IN_BYTES		((SH_REG_IN_BITCOUNT + 7) / 8)
+#define SH_REG_IN_MASK		((sr_in_data_t)(((uint64_t)1 << SH_REG_IN_BITCOUNT) - 1))
+#endif
+
+#ifdef BTN_EVENT_QUEUE
+#if (BTN_EVENT_QUEUE < 2) || (BTN_EVENT_QUEUE > 128) || (BTN_EVENT_QUEUE & (BTN_EVENT_QUEUE - 1))
+#error "BTN_EVENT_QUEUE must be a power of 2 (2..128)"
+#endif
+#define BTN_QUEUE_MASK	(BTN_EVENT_QUEUE - 1)
+#endif
+
+#ifdef SERIAL_BAUD
+#ifndef SWAP_PINS_PD01_FOR_PB01
+#error "SERIAL_BAUD requires SWAP_PINS_PD01_FOR_PB01"
+#endif
+#if (SERIAL_TX_BUFFER < 8) || (SERIAL_TX_BUFFER > 128) || (SERIAL_TX_BUFFER & (SERIAL_TX_BUFFER - 1))
+#error "SERIAL_TX_BUFFER must be a power of 2 (8..128)"
+#endif
+#if (SERIAL_RX_BUFFER < 2) || (SERIAL_RX_BUFFER > 128) || (SERIAL_RX_BUFFER & (SERIAL_RX_BUFFER - 1))
+#error "SERIAL_RX_BUFFER must be a power of 2 (2..128)"
+#endif
+#define SERIAL_UBRR		((F_CPU + 8UL * SERIAL_BAUD) / (16UL * SERIAL_BAUD) - 1)
+#define TX_MASK			(SERIAL_TX_BUFFER - 1)
+#define RX_MASK			(SERIAL_RX_BUFFER - 1)
+// frame decoder states
+#define RX_START		0
+#define RX_TYPE			1
+#define RX_LEN			2
+#define RX_PAYLOAD		3
+#define RX_CHECKSUM		4
+// USART vectors (ATtiny2313: USART_*, ATtiny4313: USART0_*)
+#if !defined(USART_RX_vect) && defined(USART0_RX_vect)
+#define USART_RX_vect	USART0_RX_vect
+#define USART_UDRE_vect	USART0_UDRE_vect
+#endif
+#endif
+
+#ifdef EEPROM_RECORD_SIZE
+#if (EEPROM_RECORD_SIZE < 1) || (EEPROM_RECORD_SIZE > 32)
+#error "EEPROM_RECORD_SIZE must be in the range 1..32"
+#endif
+#define EE_SLOT_SIZE	(EEPROM_RECORD_SIZE + 2)	// sequence number, record, checksum
+#define EE_SLOTS		((EEPROM_RING_END - EEPROM_RING_START + 1) / EE_SLOT_SIZE)
+#define EE_LAST_SLOT	(EEPROM_RING_START + (EE_SLOTS - 1) * EE_SLOT_SIZE)
+#define EE_IDLE			(EE_SLOT_SIZE + 1)	// ee_pos: no record being written
+#if (EE_SLOTS < 2) || (EE_SLOTS > 127)
+#error "the EEPROM ring must hold 2..127 slots"
+#endif
+#if (EEPROM_RING_END > 255) || (EEPROM_RING_END > E2END)
+#error "EEPROM_RING_END exceeds the EEPROM"
+#endif
+#if !defined(EE_READY_vect) && defined(EEPROM_READY_vect)
+#define EE_READY_vect	EEPROM_READY_vect
+#endif
+#endif
+
+#ifdef PROTOCOUNTER_STATS
+#define STATS_CYCLE		((uint16_t)(F_CPU / 8 / TICK_FREQ))	// update cycle in timer1 counts
+#define STATS_MAX_TIME	0x1FFF				// limit for the mean (8 * mean fits in 16 bit)
+#ifndef STATS_DEBUG_PORT
+#define STATS_DEBUG_PORT	PORTB
+#define STATS_DEBUG_DDR		DDRB
+#define STATS_DEBUG_ON_PORTB				// pin is checked against the other port B pins
+#endif
+#endif
+
+// pin change interrupt of port B (ATtiny2313: PCINT, ATtiny2313A/4313: PCINT_B)
+#ifdef PIN_CHANGE_INT
+#if defined(PCINT_B_vect)
+#define PCINT_PB_vect	PCINT_B_vect
+#else
+#define PCINT_PB_vect	PCINT_vect
+#endif
+#ifndef PCIE
+#define PCIE			PCIE0
+#endif
+#ifndef PCMSK
+#define PCMSK			PCMSK0
+#endif
+#endif
+
+#ifdef COUNTER_CHANNELS
+#if (COUNTER_CHANNELS < 1) || (COUNTER_CHANNELS > 3)
+#error "COUNTER_CHANNELS must be in the range 1..3"
+#endif
+#define COUNTER_MASK	(((1 << COUNTER_CHANNELS) - 1) << COUNTER_FIRST_BIT)
+#endif
+
+#ifdef FREQ_METER
+#if (FREQ_BIT < 2) || (FREQ_BIT > 4)
+#error "FREQ_BIT must be one of the free pins PB2..PB4"
+#endif
+#if defined(COUNTER_CHANNELS) && (COUNTER_MASK & (1 << FREQ_BIT))
+#error "FREQ_BIT is already used by a pulse counter channel"
+#endif
+#if (F_CPU % 512) != 0
+#error "frequency meter needs F_CPU to be a multiple of 512 Hz"
+#endif
+#define FREQ_COUNTS_PER_S	(F_CPU / 64)			// timer0 counts per second
+#define FREQ_TIME_MASK		0x00FFFFFFUL			// time stamps have 24 bits
+#define FREQ_MAX_EDGES		0x8000					// end gate early to avoid overflow
+#endif
+
+#ifdef ENCODER
+#if (ENCODER_A_BIT < 2) || (ENCODER_A_BIT > 4) || (ENCODER_B_BIT < 2) || (ENCODER_B_BIT > 4) || (ENCODER_A_BIT == ENCODER_B_BIT)
+#error "ENCODER_A_BIT and ENCODER_B_BIT must be two of the free pins PB2..PB4"
+#endif
+#define ENCODER_MASK	((1 << ENCODER_A_BIT) | (1 << ENCODER_B_BIT))
+#if defined(COUNTER_CHANNELS) && (COUNTER_MASK & ENCODER_MASK)
+#error "an encoder pin is already used by a pulse counter channel"
+#endif
+#if defined(FREQ_METER) && (ENCODER_MASK & (1 << FREQ_BIT))
+#error "an encoder pin is already used by the frequency meter"
+#endif
+#define ENCODER_STATE(level)	((((level) >> ENCODER_A_BIT) & 1) << 1 | (((level) >> ENCODER_B_BIT) & 1))
+#define ENCODER_ILLEGAL	2					// transition table: both signals changed
+#endif
+
+#if defined(STATS_DEBUG_BIT) && defined(STATS_DEBUG_ON_PORTB)
+#if (STATS_DEBUG_BIT < 2) || (STATS_DEBUG_BIT > 4)
+#error "STATS_DEBUG_BIT must be one of the free pins PB2..PB4"
+#endif
+#if defined(COUNTER_CHANNELS) && (COUNTER_MASK & (1 << STATS_DEBUG_BIT))
+#error "STATS_DEBUG_BIT is already used by a pulse counter channel"
+#endif
+#if defined(FREQ_METER) && (STATS_DEBUG_BIT == FREQ_BIT)
+#error "STATS_DEBUG_BIT is already used by the frequency meter"
+#endif
+#if defined(ENCODER) && (ENCODER_MASK & (1 << STATS_DEBUG_BIT))
+#error "STATS_DEBUG_BIT is already used by the encoder"
+#endif
+#endif
+
+// analog comparator settings
+#ifdef ANALOG_HIGH_RES
+#ifndef ANALOG_ENABLE
+#error "ANALOG_HIGH_RES requires ANALOG_ENABLE"
+#endif
+#define ANALOG_ACSR		((1<<ACBG) | (1<<ACI) | (1<<ACIC) | (2<<ACIS0))	// with input capture
+#else
+#define ANALOG_ACSR		((1<<ACBG) | (1<<ACI) | (2<<ACIS0))
+#endif
+
+// software timers
+#ifdef SOFT_TIMERS
+#if (SOFT_TIMERS < 1) || (SOFT_TIMERS > 8)
+#error "SOFT_TIMERS must be in the range 1..8"
+#endif
+#endif
+
+// event rate
+#ifdef RATE_BINS
+#if (RATE_BINS < 2) || (RATE_BINS > 32)
+#error "RATE_BINS must be in the range 2..32"
+#endif
+#if (RATE_WINDOW < 1) || (RATE_WINDOW > RATE_BINS)
+#error "RATE_WINDOW must be in the range 1..RATE_BINS"
+#endif
+#if defined(RATE_COUNTER_CHANNEL) && (!defined(COUNTER_CHANNELS) || (RATE_COUNTER_CHANNEL >= COUNTER_CHANNELS))
+#error "RATE_COUNTER_CHANNEL is not a pulse counter channel"
+#endif
+#endif
+
+#if (SH_REG_INTERVAL == 0) && !defined(SH_REG_OUT_ON_CHANGE)
+#error "SH_REG_INTERVAL = 0 requires SH_REG_OUT_ON_CHANGE"
+#endif
+#ifdef SH_REG_BCM
+#if (SH_REG_BCM < 4) || (SH_REG_BCM > 8)
+#error "SH_REG_BCM must be in the range 4..8"
+#endif
+#if SH_REG_OUT_BITCOUNT == 0
+#error "SH_REG_BCM needs output shift registers"
+#endif
+#endif
+#if defined(SH_REG_DEBOUNCE) && (SH_REG_IN_BITCOUNT == 0)
+#error "SH_REG_DEBOUNCE needs input shift registers"
+#endif
+
+// pulse counters on the shift register inputs
+#ifdef SH_REG_COUNTERS
+#if (SH_REG_COUNTERS < 1) || (SH_REG_COUNTERS > SH_REG_IN_BITCOUNT)
+#error "SH_REG_COUNTERS must be in the range 1..SH_REG_IN_BITCOUNT"
+#endif
+#define COUNT_MASK		((sr_in_data_t)(((uint64_t)1 << SH_REG_COUNTERS) - 1))
+#endif
+
+// extended display: anodes of the extra digits in the output shift registers
+#ifdef EXT_DIGITS
+#if (EXT_DIGITS < 1) || (EXT_DIGITS > 5)
+#error "EXT_DIGITS must be in the range 1..5"
+#endif
+#if SH_REG_OUT_BITCOUNT < EXT_DIGITS
+#error "EXT_DIGITS needs at least EXT_DIGITS output shift register bits"
+#endif
+#define EXT_ANODE_LSB	((sr_out_data_t)1 << (SH_REG_OUT_BITCOUNT - EXT_DIGITS))	// rightmost extra digit
+#define EXT_ANODE_MASK	(EXT_ANODE_LSB * ((1 << EXT_DIGITS) - 1))				// all extra digits
+#endif
+
+// multiplexing by timer1 (CTC mode, prescaler 1:8)
+#ifdef MUX_TIMER1
+#if (MUX_FREQ < 32) || (MUX_FREQ > 10000)
+#error "MUX_FREQ must be in the range 32..10000"
+#endif
+#ifdef ANALOG_HIGH_RES
+#error "MUX_TIMER1 and ANALOG_HIGH_RES both need timer1"
+#endif
+#ifdef FREQ_METER
+#error "FREQ_METER needs update() to be called by the timer0 compare B interrupt"
+#endif
+#define MUX_TOP			((uint16_t)(F_CPU / 8 / MUX_FREQ - 1))
+// brightness that matches a dimming level with blank update cycles
+#define MUX_BRIGHTNESS(dim)	((1024 / (MAX_DIGITS+1 + (dim))) > 255 ? 255 : (1024 / (MAX_DIGITS+1 + (dim))))
+#endif
+
+// compile time or run time settings
+#ifdef MUX_TIMER1
+#define DIMMING_LEVEL	0				// brightness is set by the on-time
+#elif defined(FIXED_DIMMING)
+#define DIMMING_LEVEL	DIMMING
+#else
+#define DIMMING_LEVEL	dimming
+#endif
+#ifdef FIXED_DECIMAL_PLACES
+#define DECIMALS		DECIMAL_PLACES
+#else
+#define DECIMALS		decimal_places
+#endif
+#ifdef FIXED_ANALOG_RESOLUTION
+#define ANALOG_RES		ANALOG_RESOLUTION
+#else
+#define ANALOG_RES		analog_resolution
+#endif
+
+// display buffer written by the display functions and shown by update()
+#ifdef DISPLAY_DOUBLE_BUFFER
+#define DISPLAY_BACK	back
+#define DISPLAY_FRONT	front
+#else
+#define DISPLAY_BACK	display
+#define DISPLAY_FRONT	display
+#endif
+
+// Benchmark probes: mark start and end of a time critical code section.
+// They expand to nothing unless a benchmark defines them
+// (see "extras/benchmark/probes.h").
+#ifndef PROBE_START
+#define PROBE_START(id)
+#define PROBE_STOP(id)
+#endif
 
 
 /**************************
@@ -80,20 +358,164 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 // Member variable "display" contains the led patterns (0=on, 1=off)
 // for each digit of the display.
 // display[0] is the rightmost digit.
-
+// With DISPLAY_DOUBLE_BUFFER there are two such arrays: update() shows
+// the front buffer while the display functions write to the back buffer.
+
+#ifdef DISPLAY_DOUBLE_BUFFER
+uint8_t ProtoCounter::display[2][MAX_DIGITS];
+uint8_t* volatile ProtoCounter::front;
+uint8_t* volatile ProtoCounter::back;
+volatile uint8_t ProtoCounter::frame_pending;
+uint8_t ProtoCounter::frame_depth;
+#else
 uint8_t ProtoCounter::display[MAX_DIGITS];
+#endif
+#ifdef SERIAL_BAUD
+uint8_t ProtoCounter::tx_buffer[SERIAL_TX_BUFFER];
+volatile uint8_t ProtoCounter::tx_head;
+volatile uint8_t ProtoCounter::tx_tail;
+uint8_t ProtoCounter::rx_buffer[SERIAL_RX_BUFFER];
+volatile uint8_t ProtoCounter::rx_head;
+volatile uint8_t ProtoCounter::rx_tail;
+uint8_t ProtoCounter::rx_state;
+uint8_t ProtoCounter::rx_type;
+uint8_t ProtoCounter::rx_len;
+uint8_t ProtoCounter::rx_pos;
+uint8_t ProtoCounter::rx_sum;
+uint8_t ProtoCounter::rx_payload[SERIAL_MAX_PAYLOAD];
+#endif
+#ifdef EEPROM_RECORD_SIZE
+uint8_t ProtoCounter::ee_buffer[EEPROM_RECORD_SIZE + 2];
+volatile uint8_t ProtoCounter::ee_pos;
+uint8_t ProtoCounter::ee_addr;
+uint8_t ProtoCounter::ee_next;
+uint8_t ProtoCounter::ee_seq;
+#endif
+#ifdef MARQUEE
+const char* ProtoCounter::marquee_text;
+uint8_t ProtoCounter::marquee_flash;
+uint8_t ProtoCounter::marquee_tail;
+uint16_t ProtoCounter::marquee_speed;
+volatile uint16_t ProtoCounter::marquee_timer;
+uint8_t ProtoCounter::marquee_due;
+void (*ProtoCounter::marquee_callback)(void);
+#endif
 uint8_t ProtoCounter::button;
+#ifdef POWER_MANAGER
+uint16_t ProtoCounter::display_timeout;
+volatile uint16_t ProtoCounter::idle_timer;
+#endif
+#if !defined(FIXED_DIMMING) && !defined(MUX_TIMER1)
 uint8_t ProtoCounter::dimming;
+#endif
+#ifdef MUX_TIMER1
+uint16_t ProtoCounter::mux_on_time;
+#endif
+#ifndef FIXED_ANALOG_RESOLUTION
 uint8_t ProtoCounter::analog_resolution;
+#endif
+#ifndef FIXED_DECIMAL_PLACES
 uint8_t ProtoCounter::decimal_places;
+#endif
 uint8_t ProtoCounter::pb_timer;
 uint8_t ProtoCounter::pb_delay_timer;
+#ifdef BTN_EVENT_QUEUE
+volatile uint8_t ProtoCounter::btn_queue_event[BTN_EVENT_QUEUE];
+volatile uint16_t ProtoCounter::btn_queue_time[BTN_EVENT_QUEUE];
+volatile uint8_t ProtoCounter::btn_queue_head;
+volatile uint8_t ProtoCounter::btn_queue_tail;
+#endif
+#ifdef TICK_COUNTER
+volatile uint16_t ProtoCounter::ticks;
+#endif
+#ifdef SOFT_TIMERS
+uint16_t ProtoCounter::timer_rounds[SOFT_TIMERS];
+uint16_t ProtoCounter::timer_period[SOFT_TIMERS];
+uint8_t ProtoCounter::timer_slot[SOFT_TIMERS];
+uint8_t ProtoCounter::wheel_slot[TIMER_WHEEL_SLOTS];
+void (*ProtoCounter::timer_callback[SOFT_TIMERS])(void);
+volatile uint8_t ProtoCounter::timer_running;
+volatile uint8_t ProtoCounter::timer_expired;
+uint8_t ProtoCounter::wheel_pos;
+#endif
+#ifdef RATE_BINS
+uint16_t ProtoCounter::rate_bin[RATE_BINS];
+volatile uint16_t ProtoCounter::rate_events;
+volatile uint32_t ProtoCounter::rate_sum;
+uint16_t ProtoCounter::rate_timer;
+uint8_t ProtoCounter::rate_pos;
+uint8_t ProtoCounter::rate_window;
+uint8_t ProtoCounter::rate_filled;
+#endif
 
+#ifdef PROTOCOUNTER_STATS
+isr_stats_t ProtoCounter::stats;
+uint8_t ProtoCounter::stats_depth;
+#endif
 volatile sr_in_data_t  ProtoCounter::sh_reg_in_data;
 volatile sr_out_data_t ProtoCounter::sh_reg_out_data;
+#ifdef SH_REG_OUT_ON_CHANGE
+volatile uint8_t ProtoCounter::sh_reg_dirty;
+#endif
+#ifdef SH_REG_BCM
+sr_out_data_t ProtoCounter::bcm_plane[SH_REG_BCM];
+uint8_t ProtoCounter::bcm_slot;
+uint8_t ProtoCounter::bcm_timer;
+#endif
+#ifdef SH_REG_DEBOUNCE
+sr_in_data_t ProtoCounter::debounce_cnt0;
+sr_in_data_t ProtoCounter::debounce_cnt1;
+volatile sr_in_data_t ProtoCounter::input_state;
+volatile sr_in_data_t ProtoCounter::input_rising;
+volatile sr_in_data_t ProtoCounter::input_falling;
+#endif
+#ifdef SH_REG_COUNTERS
+sr_in_data_t ProtoCounter::count_slice[COUNT_SLICES];
+uint32_t ProtoCounter::count_total[SH_REG_COUNTERS];
+uint8_t ProtoCounter::count_flush;
+sr_in_data_t ProtoCounter::count_flush_mask;
+#ifndef SH_REG_DEBOUNCE
+sr_in_data_t ProtoCounter::count_last;
+#endif
+#endif
+
+#ifdef PIN_CHANGE_INT
+uint8_t ProtoCounter::pin_level;
+#endif
+#ifdef COUNTER_CHANNELS
+volatile int32_t ProtoCounter::counter[COUNTER_CHANNELS];
+uint8_t ProtoCounter::counter_deadtime[COUNTER_CHANNELS];
+volatile uint8_t ProtoCounter::counter_timer[COUNTER_CHANNELS];
+#endif
+#ifdef FREQ_METER
+volatile uint16_t ProtoCounter::freq_edges;
+volatile uint32_t ProtoCounter::freq_first;
+volatile uint32_t ProtoCounter::freq_last;
+uint16_t ProtoCounter::freq_timer;
+volatile uint16_t ProtoCounter::freq_periods;
+volatile uint32_t ProtoCounter::freq_time;
+#endif
+#ifdef ENCODER
+volatile int32_t ProtoCounter::encoder_steps;
+volatile uint16_t ProtoCounter::encoder_errors;
+uint8_t ProtoCounter::encoder_state;
+uint8_t ProtoCounter::encoder_resolution;
+#ifdef ENCODER_DISPLAY
+volatile uint8_t ProtoCounter::encoder_changed;
+#endif
+#endif
 
 volatile uint8_t ProtoCounter::analog;
+#ifdef ANALOG_HIGH_RES
+volatile uint16_t ProtoCounter::start_time;
+volatile uint16_t ProtoCounter::analog_raw;
+uint16_t ProtoCounter::analog_min;
+uint16_t ProtoCounter::analog_max;
+uint16_t ProtoCounter::analog_scale;
+#else
 volatile uint8_t ProtoCounter::start_time;
+volatile uint8_t ProtoCounter::analog_scale;
+#endif
 
 
 /***********
@@ -102,10 +524,56 @@ volatile uint8_t ProtoCounter::start_time;
 
 void ProtoCounter::init()
 {
+#ifdef DISPLAY_DOUBLE_BUFFER
+	front = display[0];
+	back = display[1];
+	frame_pending = 0;
+	frame_depth = 0;
+	for(uint8_t i = 0; i < MAX_DIGITS; i++) {
+		front[i] = 0xFF;				// all segments off
+	}
+#endif
+#ifdef MARQUEE
+	marquee_timer = 0;
+#endif
 	clearDisplay();
 	button = 0;
+#ifdef BTN_EVENT_QUEUE
+	btn_queue_head = 0;
+	btn_queue_tail = 0;
+#endif
+#ifdef TICK_COUNTER
+	ticks = 0;
+#endif
+#ifdef SOFT_TIMERS
+	timer_running = 0;
+	timer_expired = 0;
+	wheel_pos = 0;
+	for (uint8_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+		wheel_slot[i] = 0;
+	}
+#endif
+#ifdef RATE_BINS
+	for (uint8_t i = 0; i < RATE_BINS; i++) {
+		rate_bin[i] = 0;
+	}
+	rate_events = 0;
+	rate_sum = 0;
+	rate_timer = RATE_BIN_TIME;
+	rate_pos = 0;
+	rate_window = RATE_WINDOW;
+	rate_filled = 0;
+#endif
+#ifdef POWER_MANAGER
+	display_timeout = DISPLAY_TIMEOUT;
+	idle_timer = 0;
+#endif
+#if !defined(FIXED_DIMMING) && !defined(MUX_TIMER1)
 	dimming = DIMMING;
+#endif
+#ifndef FIXED_DECIMAL_PLACES
 	decimal_places = DECIMAL_PLACES;
+#endif
 
 	ANODE_PORT |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// all anodes off
 	ANODE_DDR  |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// make all anodes outputs
@@ -123,10 +591,41 @@ void ProtoCounter::init()
 #if SH_REG_IN_BITCOUNT > 0
 	sh_reg_in_data = 0;
 #endif
+#ifdef SH_REG_DEBOUNCE
+	debounce_cnt0 = 0;
+	debounce_cnt1 = 0;
+	input_state = 0;
+	input_rising = 0;
+	input_falling = 0;
+#endif
+#ifdef SH_REG_COUNTERS
+	for (uint8_t i = 0; i < COUNT_SLICES; i++) {
+		count_slice[i] = 0;
+	}
+	for (uint8_t ch = 0; ch < SH_REG_COUNTERS; ch++) {
+		count_total[ch] = 0;
+	}
+	count_flush = 0;
+	count_flush_mask = 1;
+#ifndef SH_REG_DEBOUNCE
+	count_last = ~0;					// inputs that are high at power-up are not counted
+#endif
+#endif
 
 #if SH_REG_OUT_BITCOUNT > 0
+#ifdef EXT_DIGITS
+	sh_reg_out_data = EXT_ANODE_MASK;	// extra digits off
+#else
 	sh_reg_out_data = 0;
 #endif
+#endif
+#ifdef SH_REG_BCM
+	for (uint8_t i = 0; i < SH_REG_BCM; i++) {
+		bcm_plane[i] = 0;
+	}
+	bcm_slot = SH_REG_BCM - 1;			// start with bit plane 0
+	bcm_timer = 0;
+#endif
 
 #if (SH_REG_IN_BITCOUNT > 0) || (SH_REG_OUT_BITCOUNT > 0)
 	SH_REG_LD_PORT &= ~(1<<SH_REG_LD_BIT);		// low
@@ -136,25 +635,159 @@ void ProtoCounter::init()
 #ifdef ANALOG_ENABLE
 	AIN1_PORT &= ~(1<<AIN1_BIT);		// output LOW on AIN1 to discharge capacitor
 	AIN1_DDR  |=  (1<<AIN1_BIT);
-	ACSR = (1<<ACBG) | (1<<ACI)| (2<<ACIS0);	// use bandgap reference, int on falling edge
+	ACSR = ANALOG_ACSR;					// use bandgap reference, int on falling edge
 	DIDR = (1<<AIN1D);					// disable digital input on AIN1
-	analog_resolution = ANALOG_MAX_RESOLUTION;
+#ifndef FIXED_ANALOG_RESOLUTION
+	analog_resolution = ANALOG_RESOLUTION;
+#endif
 	analog = 0;
+#ifdef ANALOG_HIGH_RES
+	analog_raw = 0;
+	analog_min = ANALOG_CAL_MIN;
+	analog_max = ANALOG_CAL_MAX;
+	TCCR1A = 0;							// timer1: normal mode
+	TCCR1B = (1<<CS11);					// prescaler 1:8, capture on falling edge
+#endif
+	calibrateAnalog();
 #endif
 
-#ifdef ARDUINO
+#ifdef COUNTER_CHANNELS
+	for (uint8_t ch = 0; ch < COUNTER_CHANNELS; ch++) {
+		counter[ch] = 0;
+		counter_deadtime[ch] = COUNTER_DEADTIME;
+		counter_timer[ch] = 0;
+	}
+	COUNTER_DDR  &= ~COUNTER_MASK;		// inputs
+	COUNTER_PORT |=  COUNTER_MASK;		// with pull-up
+	PCMSK |= COUNTER_MASK;				// enable pin change interrupt
+#endif
+
+#ifdef FREQ_METER
+	freq_edges = 0;
+	freq_timer = 0;
+	freq_periods = 0;
+	COUNTER_DDR  &= ~(1<<FREQ_BIT);		// input
+	COUNTER_PORT |=  (1<<FREQ_BIT);		// with pull-up
+	PCMSK |= (1<<FREQ_BIT);				// enable pin change interrupt
+#endif
+
+#ifdef ENCODER
+	encoder_steps = 0;
+	encoder_errors = 0;
+	encoder_resolution = ENCODER_RESOLUTION;
+#ifdef ENCODER_DISPLAY
+	encoder_changed = 1;				// show initial position
+#endif
+	COUNTER_DDR  &= ~ENCODER_MASK;		// inputs
+	COUNTER_PORT |=  ENCODER_MASK;		// with pull-up
+	PCMSK |= ENCODER_MASK;				// enable pin change interrupt
+#endif
+
+#ifdef PIN_CHANGE_INT
+	pin_level = PINB;
+#ifdef ENCODER
+	encoder_state = ENCODER_STATE(pin_level);
+#endif
+	GIMSK |= (1<<PCIE);
+#endif
+
+#ifdef EEPROM_RECORD_SIZE
+	ee_pos = EE_IDLE;
+	ee_next = EEPROM_RING_START;
+	ee_seq = 0;
+#endif
+
+#ifdef SERIAL_BAUD
+	tx_head = 0;
+	tx_tail = 0;
+	rx_head = 0;
+	rx_tail = 0;
+	rx_state = RX_START;
+	UBRRH = (uint8_t)(SERIAL_UBRR >> 8);
+	UBRRL = (uint8_t)SERIAL_UBRR;
+	UCSRA = 0;
+	UCSRC = (1<<UCSZ1) | (1<<UCSZ0);	// 8 data bits, no parity, 1 stop bit
+	UCSRB = (1<<RXCIE) | (1<<RXEN) | (1<<TXEN);
+#endif
+
+#ifdef MUX_TIMER1
+	// timer1 calls update() (see ISR(TIMER1_COMPA_vect))
+	setBrightness(MUX_BRIGHTNESS(DIMMING));
+	TCCR1A = 0;
+	OCR1A = MUX_TOP;
+	TCNT1 = 0;
+	TCCR1B = (1<<WGM12) | (1<<CS11);	// CTC mode, prescaler 1:8
+	TIMSK |= (1 << OCIE1A);				// enable OC1A interrupt
+#if defined(ANALOG_ENABLE) && !defined(ANALOG_HIGH_RES) && !defined(ARDUINO)
+	// the analog knob times its ramp with timer0, which is
+	// started by the Arduino core only
+	if ((TCCR0B & ((1<<CS02)|(1<<CS01)|(1<<CS00))) == 0) {
+		TCCR0A = 0;
+		TCCR0B = (1<<CS01) | (1<<CS00);	// normal mode, prescaler 1:64
+	}
+#endif
+#elif defined(ARDUINO)
 	// use timer0 compare B interrupt for ProtoCounter
 	OCR0B = 125;						// an arbitrary value
 	TIMSK |= (1 << OCIE0B);				// enable OC0B interrupt
 #endif
+
+#ifdef PROTOCOUNTER_STATS
+	resetStats();
+	stats_depth = 0;
+#if !defined(MUX_TIMER1) && !defined(ANALOG_HIGH_RES)
+	TCCR1A = 0;							// timer1: normal mode
+	TCCR1B = (1<<CS11);					// prescaler 1:8
+#endif
+#ifdef STATS_DEBUG_BIT
+	STATS_DEBUG_PORT &= ~(1<<STATS_DEBUG_BIT);
+	STATS_DEBUG_DDR  |=  (1<<STATS_DEBUG_BIT);
+#endif
+#endif
+}
+
+
+#ifdef DISPLAY_DOUBLE_BUFFER
+void ProtoCounter::beginFrame()
+// Start writing a new display frame. All following display writes go to
+// the back buffer and become visible together after commitFrame().
+// Calls may be nested, the frame is committed by the outermost commitFrame().
+{
+	uint8_t pending;
+
+	if (frame_depth++ == 0) {
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			pending = frame_pending;
+			frame_pending = 0;			// cancel a page flip that has not yet happened
+		}
+		if (!pending) {					// back buffer is outdated
+			for(uint8_t i = 0; i < MAX_DIGITS; i++) {
+				back[i] = front[i];
+			}
+		}
+	}
+}
+
+
+void ProtoCounter::commitFrame()
+// Finish the display frame. update() shows it at the next frame boundary.
+{
+	if (frame_depth == 0) { return; }
+	frame_depth--;
+	if (frame_depth == 0) {
+		frame_pending = 1;				// request page flip
+	}
 }
+#endif
 
 
 void ProtoCounter::clearDisplay()
 {
+	beginFrame();
 	for(uint8_t i = 0; i < MAX_DIGITS; i++) {
-		display[i] = 0xFF;
+		DISPLAY_BACK[i] = 0xFF;
 	}
+	commitFrame();
 }
 
 
@@ -162,7 +795,14 @@ uint8_t ProtoCounter::getDisplay(uint8_t pos)
 // return content of display position
 // as a bit pattern (0 = led off, 1 = led on)
 {
+#ifdef DISPLAY_DOUBLE_BUFFER
+	if (frame_depth || frame_pending) {	// back buffer holds the latest frame
+		return (~back[pos]);
+	}
+	return (~front[pos]);
+#else
 	return (~display[pos]);
+#endif
 }
 
 
@@ -170,13 +810,42 @@ void ProtoCounter::setDisplay(uint8_t led_pattern, uint8_t pos)
 // write led bit pattern (0=off, 1=on) into display position (0 = rightmost digit)
 {
 	if (pos >= MAX_DIGITS) { return; }
-	display[pos] = ~led_pattern;
+	beginFrame();
+	DISPLAY_BACK[pos] = ~led_pattern;
+	commitFrame();
 }
 
 
-void ProtoCounter::writeChar(uint8_t ascii_code, uint8_t pos)
-// write an ASCII character at given display position (0 = rightmost digit)
+uint8_t ProtoCounter::charToPattern(uint8_t ascii_code)
+// convert an ASCII character to a led bit pattern (0 = off, 1 = on)
 {
+#ifdef REDUCED_CHARSET
+	// character generator: hex digits followed by the characters of char_set
+	static const uint8_t char_gen[] PROGMEM = {	0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+												0x7F, 0x6F, 0x77, 0x7C, 0x58, 0x5E, 0x79, 0x71,
+												0x40, 0x3D, 0x74, 0x76, 0x38, 0x37, 0x3E};
+	static const char char_set[] PROGMEM = "-GHKLMV";	// used by the library
+	uint8_t i;
+	char	ch;
+
+	// ASCII codes 0 to 15 are mapped to '0'..'9', 'A'..'F'.
+	// Small letters are mapped to capital letters.
+	// Characters that are not in the set are mapped to <space>.
+	if (ascii_code >= 'a')							{ ascii_code -= ('a' - 'A'); }
+	if ((uint8_t)(ascii_code - '0') <= 9)			{ ascii_code -= '0'; }
+	else if ((uint8_t)(ascii_code - 'A') <= 5)		{ ascii_code -= ('A' - 10); }
+	else if (ascii_code > 15) {
+		i = 16;
+		while ((ch = pgm_read_byte( &char_set[i-16] ))) {
+			if (ch == ascii_code) {
+				return (pgm_read_byte( &char_gen[i] ));
+			}
+			i++;
+		}
+		return (0);
+	}
+	return (pgm_read_byte( &char_gen[ascii_code] ));
+#else
 	// character generator (decimal to 7-segment)
 	static const uint8_t char_gen[] PROGMEM = {	0x00, 0x30, 0x22, 0x14, 0x2D, 0x1B, 0x70, 0x20,
 												0x39, 0x0F, 0x63, 0x46, 0x10, 0x40, 0x80, 0x52,
@@ -196,7 +865,15 @@ void ProtoCounter::writeChar(uint8_t ascii_code, uint8_t pos)
 	else if (ascii_code <= 95)	{ ascii_code -= 32; }
 	else if (ascii_code <= 127)	{ ascii_code -= 64; }
 	else						{ ascii_code  =  0; }
-	setDisplay(pgm_read_byte( &char_gen[ascii_code] ), pos);
+	return (pgm_read_byte( &char_gen[ascii_code] ));
+#endif
+}
+
+
+void ProtoCounter::writeChar(uint8_t ascii_code, uint8_t pos)
+// write an ASCII character at given display position (0 = rightmost digit)
+{
+	setDisplay(charToPattern(ascii_code), pos);
 }
 
 
@@ -206,6 +883,7 @@ void ProtoCounter::writeString_P(const char* st)
 	char	ch;
 	uint8_t pos;
 
+	beginFrame();
 	pos = MAX_DIGITS;
 	ch = pgm_read_byte(st);
 	while (ch && pos)
@@ -215,15 +893,108 @@ void ProtoCounter::writeString_P(const char* st)
 		st++;
 		ch = pgm_read_byte(st);
 	}
+#ifdef EXT_DIGITS
+	while (pos) {						// clear remaining digits
+		pos--;
+		writeChar(' ', pos);
+	}
+#endif
+	commitFrame();
+}
+
+
+#ifdef MARQUEE
+void ProtoCounter::startMarquee(const char* st, uint16_t speed, void (*callback)(void))
+// Scroll a string that is stored in RAM through the display. Each "speed"
+// update cycles the text moves one digit to the left. When the text has
+// passed the display the callback is called (if not 0).
+// The string is read while scrolling and must not be changed until then.
+{
+	startMarquee(st, 0, speed, callback);
+}
+
+
+void ProtoCounter::startMarquee_P(const char* st, uint16_t speed, void (*callback)(void))
+// same as startMarquee() for a string that is stored in flash memory
+{
+	startMarquee(st, 1, speed, callback);
+}
+
+
+void ProtoCounter::startMarquee(const char* st, uint8_t flash, uint16_t speed, void (*callback)(void))
+{
+	if (speed == 0) { speed = 1; }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		marquee_text = st;
+		marquee_flash = flash;
+		marquee_tail = MAX_DIGITS;
+		marquee_speed = speed;
+		marquee_callback = callback;
+		marquee_timer = speed;
+		marquee_due = 0;
+	}
 }
 
 
+void ProtoCounter::stopMarquee()
+// stop scrolling (the display keeps its content)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		marquee_timer = 0;
+	}
+}
+
+
+uint8_t ProtoCounter::isMarqueeRunning()
+{
+	uint8_t running;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		running = (marquee_timer != 0);
+	}
+	return (running);
+}
+
+
+inline void ProtoCounter::scrollMarquee()
+// Shift the shown display content one digit to the left and append the
+// next character of the text. Called by update() at a frame boundary.
+{
+	uint8_t i;
+	char	ch;
+
+	for (i = MAX_DIGITS-1; i > 0; i--) {
+		DISPLAY_FRONT[i] = DISPLAY_FRONT[i-1];
+	}
+	ch = marquee_flash ? pgm_read_byte(marquee_text) : *marquee_text;
+	if (ch) {
+		marquee_text++;
+	}
+	else {
+		ch = ' ';						// end of text: scroll in blanks
+		marquee_tail--;
+	}
+	DISPLAY_FRONT[0] = ~charToPattern(ch);
+	if (marquee_tail == 0) {			// text has passed the display
+		marquee_timer = 0;
+		if (marquee_callback) {
+			marquee_callback();
+		}
+	}
+}
+#endif
+
+
 void ProtoCounter::writeInt(int16_t val)
-// Convert an integer from -99..999 to a decimal number and display it.
+// Convert an integer from MIN_DECIMAL..MAX_DECIMAL to a decimal number
+// and display it.
 {
+#if MAX_DIGITS == 3
     uint8_t i, ii, d;
 	uint8_t digit[3] = {0, 0, 0};
+#endif
 
+#if MAX_DIGITS <= 4						// (with 5 or more digits every value fits)
 	// range check
 	if (val > MAX_DECIMAL) {
 		writeString_P(PSTR("0FL"));		// write "OFL" = overflow
@@ -233,8 +1004,13 @@ void ProtoCounter::writeInt(int16_t val)
 		writeString_P(PSTR("VFL"));		// write "UFL" = underflow
 		return;
 	}
+#endif
 
+#if MAX_DIGITS > 3
+	writeFixed(val, DECIMALS);			// extended display: 32 bit conversion
+#else
 	// write sign
+	beginFrame();
 	ii = MAX_DIGITS;					// number of digits to display
 	if (val < 0) {
 		val = -val;
@@ -266,304 +1042,1911 @@ void ProtoCounter::writeInt(int16_t val)
 	d = ' ';
 	do {
 		ii--;
-		if ((d != ' ') || (ii == decimal_places) || (digit[ii] > 0)) {
+		if ((d != ' ') || (ii == DECIMALS) || (digit[ii] > 0)) {
 			d = digit[ii];
 		}
 		writeChar(d, ii);
 	} while (ii > 0);
+	commitFrame();
+#endif
 }
 
 
-void ProtoCounter::writeHex(uint8_t val)
+void ProtoCounter::writeLong(int32_t val)
+// Display a 32 bit integer. Like writeInt() the current number of decimal
+// places is taken into account. See writeFixed() for values that do not fit.
 {
-	uint8_t nibble;
+	writeFixed(val, DECIMALS);
+}
 
-	nibble = swap(val);
-	nibble &= 0x0F;					// upper nibble
-	if (nibble > 9)	{ nibble += ('A' - 10); }
-	else			{ nibble += ('0'); }
-	writeChar(nibble, 2);
 
-	nibble = val;
-	nibble &= 0x0F;					// lower nibble
-	if (nibble > 9)	{ nibble += ('A' - 10); }
-	else			{ nibble += ('0'); }
-	writeChar(nibble, 1);
+void ProtoCounter::writeFixed(int32_t val, uint8_t decimals)
+// Display a fixed-point number with the given number of decimal places
+// (0..9), e.g. writeFixed(1234, 2) for 12.34.
+// A number that fits into the display is written like writeInt() does.
+// With more than 3 digits the minus sign is put directly in front of the
+// number, otherwise it takes the leftmost digit.
+// If only the integer part fits, the decimal places are dropped,
+// e.g. writeFixed(1234, 2) -> " 12". This is always the case with
+// MAX_DIGITS or more decimal places, e.g. writeFixed(7300, 3) -> "  7".
+// Larger numbers are auto-ranged: since the display has no decimal point,
+// the unit prefix takes its place as in resistor markings,
+// e.g. 1234 -> "1k2", 45678 -> "45k", 123456 -> "M12", 9876543 -> "9M8".
+// Digits that do not fit are truncated.
+{
+	// powers of ten for the digit extraction
+	static const uint32_t pow10[] PROGMEM = {	10UL, 100UL, 1000UL, 10000UL, 100000UL,
+												1000000UL, 10000000UL, 100000000UL,
+												1000000000UL};
+	static const char prefix[] PROGMEM = "kMG";
+
+	uint32_t	uval, p;
+	uint8_t		digit[10];				// digit[0] = least significant digit
+	uint8_t		i, len, n, d, pos, group, k;
+	uint8_t		skip = 0;				// number of dropped decimal places
+
+	if (decimals > 9) { return; }
+
+	// write sign
+	beginFrame();
+	n = MAX_DIGITS;						// number of digits to display
+	uval = val;
+	if (val < 0) {
+		uval = -uval;
+		writeChar('-', MAX_DIGITS-1);	// write minus sign to leftmost digit
+		n--;
+	}
+
+	// convert value to digits
+	// Each digit is found by subtracting its power of ten at most 9 times.
+	// This avoids the (slow) 32 bit division and bounds the execution time.
+	len = 1;
+	for (i = 9; i > 0; i--) {
+		p = pgm_read_dword( &pow10[i-1] );
+		d = 0;
+		while (uval >= p) {
+			uval -= p;
+			d++;
+		}
+		digit[i] = d;
+		if (d && (len == 1)) { len = i + 1; }	// number of significant digits
+	}
+	digit[0] = (uint8_t)uval;
+
+	if (((len > n) || (decimals >= MAX_DIGITS)) && (len - decimals <= n)) {
+		skip = decimals;				// integer part fits: drop decimal places
+		decimals = 0;
+	}
+
+	if (len - skip <= n) {
+		// suppress leading zeroes and display result
+		d = ' ';
+		i = n;
+		do {
+			i--;
+			if ((d != ' ') || (i == decimals) || ((i + skip < len) && (digit[i + skip] > 0))) {
+				d = digit[i + skip];
+			}
+			writeChar(d, i);
+		} while (i > 0);
+#if MAX_DIGITS > 3
+		if (val < 0) {
+			// move minus sign in front of the most significant digit
+			pos = (len > skip) ? (len - skip) : 0;	// 0 = no integer digits
+			if (pos <= decimals) { pos = decimals + 1; }
+			if (pos < n) {
+				writeChar(' ', MAX_DIGITS-1);
+				writeChar('-', pos);
+			}
+		}
+#endif
+	}
+	else {
+		// auto-ranging: find the smallest unit prefix that leaves
+		// at most n-1 digits in front of the prefix
+		len -= decimals;				// number of integer digits
+		group = 1;
+		while (len > (3 * group + n - 1)) { group++; }
+		k = (len > 3 * group) ? (len - 3 * group) : 0;	// digits in front of prefix
+		i = decimals + 3 * group + k;	// index of the most significant digit + 1
+		pos = n;
+		do {
+			pos--;
+			if (pos == (n - 1 - k)) {
+				writeChar(pgm_read_byte( &prefix[group-1] ), pos);
+			}
+			else {
+				i--;
+				writeChar(digit[i], pos);
+			}
+		} while (pos > 0);
+	}
+	commitFrame();
+}
+
+
+void ProtoCounter::writeHex(uint8_t val)
+{
+	beginFrame();
+#ifdef EXT_DIGITS
+	for (uint8_t i = 3; i < MAX_DIGITS; i++) {
+		writeChar(' ', i);				// clear extra digits
+	}
+#endif
+	writeChar(swap(val) & 0x0F, 2);	// upper nibble (codes 0..15 are hex digits)
+	writeChar(val & 0x0F, 1);		// lower nibble
+	writeChar('h', 0);				// write 'h' to indicate a hex number
+	commitFrame();
+}
+
+
+#ifdef MUX_TIMER1
+#ifndef FIXED_DIMMING
+void ProtoCounter::setDimming(uint8_t dim)
+// set dimming level (0 = no dimming)
+{
+	setBrightness(MUX_BRIGHTNESS(dim));
+}
+#endif
+
+
+void ProtoCounter::setBrightness(uint8_t brightness)
+// set brightness (1..255 = on-time in 1/256 of an update cycle, 255 = full)
+{
+	uint16_t on_time;
+
+	on_time = ((uint32_t)(MUX_TOP + 1) * (brightness + 1)) >> 8;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		mux_on_time = on_time;
+	}
+}
+#elif !defined(FIXED_DIMMING)
+void ProtoCounter::setDimming(uint8_t dim)
+// set dimming level (0 = no dimming)
+{
+	dimming = dim;
+}
+#endif
+
+
+#ifndef FIXED_DECIMAL_PLACES
+void ProtoCounter::setDecimalPlaces(uint8_t decimals)
+{
+	if (decimals < MAX_DIGITS) {
+		decimal_places = decimals;
+	}
+}
+#endif
+
+
+#ifndef FIXED_ANALOG_RESOLUTION
+void ProtoCounter::setAnalogResolution(uint8_t ana_res)
+{
+	if (ana_res <= ANALOG_OFF) {
+		analog_resolution = ana_res;
+#ifdef ANALOG_ENABLE
+		calibrateAnalog();
+#endif
+	}
+}
+#endif
+
+
+#ifdef SOFT_TIMERS
+void ProtoCounter::startTimer(uint8_t id, uint16_t delay, uint16_t period, void (*callback)(void))
+// Start (or restart) timer "id". It expires after "delay" update cycles
+// and then every "period" update cycles (period 0 = one-shot).
+// On expiry the callback is called (if not 0).
+{
+	if (id >= SOFT_TIMERS) { return; }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		timer_period[id] = period;
+		timer_callback[id] = callback;
+		scheduleTimer(id, delay);
+		timer_expired &= ~(1 << id);
+		timer_running |= (1 << id);
+	}
+}
+
+
+void ProtoCounter::stopTimer(uint8_t id)
+{
+	if (id >= SOFT_TIMERS) { return; }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		wheel_slot[timer_slot[id]] &= ~(1 << id);
+		timer_running &= ~(1 << id);
+	}
+}
+
+
+uint8_t ProtoCounter::timerRunning(uint8_t id)
+{
+	if (id >= SOFT_TIMERS) { return (0); }
+	return ((timer_running & (1 << id)) != 0);
+}
+
+
+uint8_t ProtoCounter::timerExpired(uint8_t id)
+// return 1 if timer "id" has expired since the last call (clears the flag)
+{
+	uint8_t expired;
+
+	if (id >= SOFT_TIMERS) { return (0); }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		expired = timer_expired & (1 << id);
+		timer_expired &= ~expired;
+	}
+	return (expired != 0);
+}
+
+
+void ProtoCounter::scheduleTimer(uint8_t id, uint16_t delay)
+// Put timer into the slot of the wheel that is reached after "delay" update
+// cycles. The slot is visited every TIMER_WHEEL_SLOTS update cycles, the
+// timer expires when its number of remaining revolutions is zero.
+{
+	uint8_t bit = 1 << id;
+
+	if (delay == 0) { delay = 1; }
+	delay--;
+	wheel_slot[timer_slot[id]] &= ~bit;
+	timer_slot[id] = (wheel_pos + 1 + delay) & (TIMER_WHEEL_SLOTS - 1);
+	timer_rounds[id] = delay / TIMER_WHEEL_SLOTS;
+	wheel_slot[timer_slot[id]] |= bit;
+}
+
+
+inline void ProtoCounter::updateTimers()
+// Advance the wheel by one slot and process the timers of this slot only.
+// The callbacks are called after all timers of the slot have been updated,
+// so they may start or stop any timer.
+{
+	uint8_t id, bit, pending, fired = 0;
+
+	wheel_pos = (wheel_pos + 1) & (TIMER_WHEEL_SLOTS - 1);
+	pending = wheel_slot[wheel_pos];
+	for (id = 0, bit = 1; pending; id++, bit <<= 1) {
+		if (!(pending & bit)) { continue; }
+		pending &= ~bit;
+		if (timer_rounds[id]) {
+			timer_rounds[id]--;					// one more revolution
+			continue;
+		}
+		fired |= bit;							// timer has expired
+		if (timer_period[id]) {
+			scheduleTimer(id, timer_period[id]);
+		} else {
+			wheel_slot[wheel_pos] &= ~bit;
+			timer_running &= ~bit;
+		}
+	}
+	timer_expired |= fired;
+	for (id = 0, bit = 1; fired; id++, bit <<= 1) {
+		if (!(fired & bit)) { continue; }
+		fired &= ~bit;
+		if (timer_callback[id]) {
+			timer_callback[id]();
+		}
+	}
+}
+#endif
+
+
+#ifdef RATE_BINS
+void ProtoCounter::addRateEvents(uint16_t n)
+// add n events to the current bin
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		rate_events += n;
+	}
+}
+
+
+void ProtoCounter::setRateWindow(uint8_t bins)
+// Set the window of getRate() to the last "bins" bins (1..RATE_BINS).
+// The window is valid immediately as far as the bins are available.
+{
+	uint32_t sum = 0;
+	uint8_t	 pos;
+
+	if ((bins == 0) || (bins > RATE_BINS)) { return; }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		pos = rate_pos;
+		for (uint8_t i = 0; i < bins; i++) {
+			pos = (pos ? pos : RATE_BINS) - 1;	// previous bin
+			sum += rate_bin[pos];
+		}
+		rate_window = bins;
+		rate_sum = sum;
+	}
+}
+
+
+uint32_t ProtoCounter::getRate(uint16_t seconds)
+// Return the number of events per "seconds" (e.g. 60 = events per minute,
+// 3600 = per hour) averaged over the window. After startup the average is
+// taken over the bins completed so far (0 until the first bin is complete).
+{
+	uint32_t sum, d, f, r, q, m;
+	uint8_t	 bins;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		sum = rate_sum;
+		bins = rate_window;
+		if (rate_filled < bins) { bins = rate_filled; }
+	}
+	if (bins == 0) { return (0); }
+
+	// rate = sum * seconds * TICK_FREQ / (bins * RATE_BIN_TIME)
+	// The product may not fit into 32 bits, so quotient and remainder of
+	// the constant factor are multiplied separately. sum * r may not fit
+	// either (if the window does not divide the period), it is divided
+	// bit by bit: q = quotient, m = remainder (m, r < d < 2^21).
+	d = (uint32_t)bins * RATE_BIN_TIME;
+	f = (uint32_t)seconds * TICK_FREQ;
+	r = f % d;
+	q = 0;
+	m = 0;
+	for (uint32_t bit = 0x80000000UL; bit; bit >>= 1) {
+		q <<= 1;
+		m <<= 1;
+		if (m >= d) { m -= d; q++; }
+		if (sum & bit) {
+			m += r;
+			if (m >= d) { m -= d; q++; }
+		}
+	}
+	return (sum * (f / d) + q);
+}
+
+
+void ProtoCounter::writeRate(uint16_t seconds)
+// display the event rate (auto-ranging, see writeFixed())
+{
+	writeFixed(getRate(seconds), 0);
+}
+
+
+inline void ProtoCounter::updateRate()
+// complete the current bin and move the window by one bin
+{
+	uint16_t n;
+	uint8_t	 out;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		n = rate_events;
+		rate_events = 0;
+	}
+	out = rate_pos + RATE_BINS - rate_window;	// bin that drops out of the window
+	if (out >= RATE_BINS) { out -= RATE_BINS; }
+	rate_sum = rate_sum + n - rate_bin[out];
+	rate_bin[rate_pos] = n;
+	rate_pos++;
+	if (rate_pos >= RATE_BINS) { rate_pos = 0; }
+	if (rate_filled < RATE_BINS) { rate_filled++; }
+}
+#endif
+
+
+#ifdef SERIAL_BAUD
+uint8_t ProtoCounter::sendFrame(uint8_t type, const void* payload, uint8_t len)
+// Queue a frame for transmission. Returns 0 (and sends nothing) if the
+// transmit buffer has not enough room, 1 otherwise. Does not block.
+{
+	const uint8_t* data = (const uint8_t*)payload;
+	uint8_t head, sum, i;
+
+	if (len > SERIAL_MAX_PAYLOAD) { return (0); }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {		// may also be called by a callback within update()
+		head = tx_head;
+		if (((tx_tail - head - 1) & TX_MASK) < (uint8_t)(len + 4)) {
+			return (0);					// buffer full
+		}
+		tx_buffer[head] = SERIAL_FRAME_START;
+		head = (head + 1) & TX_MASK;
+		tx_buffer[head] = type;
+		head = (head + 1) & TX_MASK;
+		tx_buffer[head] = len;
+		head = (head + 1) & TX_MASK;
+		sum = type + len;
+		for (i = 0; i < len; i++) {
+			tx_buffer[head] = data[i];
+			head = (head + 1) & TX_MASK;
+			sum += data[i];
+		}
+		tx_buffer[head] = sum;
+		tx_head = (head + 1) & TX_MASK;
+		UCSRB |= (1<<UDRIE);			// start transmission
+	}
+	return (1);
+}
+
+
+uint8_t ProtoCounter::pollCommand(uint8_t* payload, uint8_t* len)
+// Decode received frames. Commands for the display and the shift register
+// outputs are executed right away. The type of any other frame is returned
+// and its payload is copied to "payload" (room for SERIAL_MAX_PAYLOAD bytes),
+// its length to "len" (if not 0). Returns 0 if no frame is available.
+{
+	uint8_t		ch, i;
+	uint32_t	val;
+
+	while (rx_tail != rx_head) {
+		ch = rx_buffer[rx_tail];
+		rx_tail = (rx_tail + 1) & RX_MASK;
+		if (rx_state == RX_START) {
+			if (ch == SERIAL_FRAME_START) { rx_state = RX_TYPE; }
+			continue;
+		}
+		if (rx_state == RX_TYPE) {
+			rx_type = ch;
+			rx_sum = ch;
+			rx_state = RX_LEN;
+			continue;
+		}
+		if (rx_state == RX_LEN) {
+			if (ch > SERIAL_MAX_PAYLOAD) {		// corrupted frame
+				rx_state = RX_START;
+				continue;
+			}
+			rx_len = ch;
+			rx_pos = 0;
+			rx_sum += ch;
+			rx_state = ch ? RX_PAYLOAD : RX_CHECKSUM;
+			continue;
+		}
+		if (rx_state == RX_PAYLOAD) {
+			rx_payload[rx_pos++] = ch;
+			rx_sum += ch;
+			if (rx_pos == rx_len) { rx_state = RX_CHECKSUM; }
+			continue;
+		}
+		rx_state = RX_START;					// checksum
+		if (ch != rx_sum) { continue; }			// corrupted frame
+
+		// complete frame: payload as little endian number,
+		// sign extended for CMD_WRITE_LONG, otherwise zero extended
+		val = 0;
+		if ((rx_type == CMD_WRITE_LONG) && rx_len && (rx_payload[rx_len-1] & 0x80)) {
+			val = 0xFFFFFFFF;
+		}
+		for (i = rx_len; i > 0; i--) {
+			val = (val << 8) | rx_payload[i-1];
+		}
+		if (rx_type == CMD_WRITE_LONG) {
+			writeLong((int32_t)val);
+		}
+		else if (rx_type == CMD_SET_DISPLAY) {
+			beginFrame();
+			for (i = 0; (i < rx_len) && (i < MAX_DIGITS); i++) {
+				setDisplay(rx_payload[i], i);
+			}
+			commitFrame();
+		}
+#if SH_REG_OUT_BITCOUNT > 0
+		else if (rx_type == CMD_WRITE_SH_REG) {
+			writeShiftRegister((sr_out_data_t)val);
+		}
+#endif
+		else {
+			for (i = 0; i < rx_len; i++) {
+				payload[i] = rx_payload[i];
+			}
+			if (len) { *len = rx_len; }
+			return (rx_type);
+		}
+	}
+	return (0);
+}
+
+
+inline void ProtoCounter::serialReceive()
+// store a received byte (called by the receive interrupt)
+{
+	uint8_t ch = UDR;
+	uint8_t next = (rx_head + 1) & RX_MASK;
+
+	if (next != rx_tail) {						// otherwise the byte is lost
+		rx_buffer[rx_head] = ch;
+		rx_head = next;
+	}
+}
+
+
+inline void ProtoCounter::serialTransmit()
+// send the next byte (called by the data register empty interrupt)
+{
+	uint8_t tail = tx_tail;
+
+	if (tail == tx_head) {
+		UCSRB &= ~(1<<UDRIE);					// buffer empty
+		return;
+	}
+	UDR = tx_buffer[tail];
+	tx_tail = (tail + 1) & TX_MASK;
+}
+#endif
+
+
+#ifdef EEPROM_RECORD_SIZE
+uint8_t ProtoCounter::loadRecord(void* record)
+// Copy the latest valid record from EEPROM to "record" (EEPROM_RECORD_SIZE
+// bytes). Returns 0 if there is none (e.g. first start), then "record" is
+// not changed. Call once after init() and before saving the first record.
+{
+	uint8_t		slot[EE_SLOT_SIZE];
+	uint8_t		n, addr, i, sum;
+	uint8_t		found = 0;
+
+	eeprom_busy_wait();
+	addr = EEPROM_RING_START;
+	for (n = 0; n < EE_SLOTS; n++, addr += EE_SLOT_SIZE) {
+		sum = 0;
+		for (i = 0; i < EE_SLOT_SIZE; i++) {
+			slot[i] = eeprom_read_byte((const uint8_t*)(uintptr_t)(addr + i));
+			sum += slot[i];
+		}
+		sum -= slot[EE_SLOT_SIZE-1];
+		if (slot[EE_SLOT_SIZE-1] != (uint8_t)~sum) { continue; }	// empty or incomplete slot
+		// sequence numbers of the ring lie within a window of less than
+		// 128, so the latest one is found by comparing differences
+		if (found && ((int8_t)(slot[0] - ee_seq) <= 0)) { continue; }
+		found = 1;
+		ee_seq = slot[0];
+		ee_next = (addr == EE_LAST_SLOT) ? EEPROM_RING_START : addr + EE_SLOT_SIZE;
+		for (i = 0; i < EEPROM_RECORD_SIZE; i++) {
+			((uint8_t*)record)[i] = slot[i+1];
+		}
+	}
+	return (found);
+}
+
+
+uint8_t ProtoCounter::saveRecord(const void* record)
+// Start writing "record" (EEPROM_RECORD_SIZE bytes) into the next slot of
+// the ring. The record is copied, so it may change immediately. Returns 0
+// if the previous record is still being written (nothing is saved then).
+// Writing takes approx. 3.4 ms per byte, see isSaving().
+{
+	uint8_t i, sum;
+
+	if (isSaving()) { return (0); }
+	ee_seq++;
+	ee_buffer[0] = ee_seq;
+	sum = ee_seq;
+	for (i = 0; i < EEPROM_RECORD_SIZE; i++) {
+		ee_buffer[i+1] = ((const uint8_t*)record)[i];
+		sum += ee_buffer[i+1];
+	}
+	ee_buffer[EE_SLOT_SIZE-1] = ~sum;
+	ee_addr = ee_next;
+	ee_next = (ee_addr == EE_LAST_SLOT) ? EEPROM_RING_START : ee_addr + EE_SLOT_SIZE;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		ee_pos = 0;
+		EECR |= (1<<EERIE);				// the interrupt writes the bytes
+	}
+	return (1);
+}
+
+
+uint8_t ProtoCounter::isSaving()
+// return 1 while a record is being written
+{
+	return (ee_pos != EE_IDLE);
+}
+
+
+inline void ProtoCounter::eepromReady()
+// Write the next byte of the slot (called by the EEPROM ready interrupt).
+// Record and checksum are written first and the sequence number last: until
+// the slot is complete it keeps the old sequence number, so even if the
+// checksum of an interrupted slot fits by chance, it is older than the
+// previous record and loadRecord() does not take it.
+{
+	uint8_t pos = ee_pos;
+	uint8_t i;
+
+	if (pos >= EE_SLOT_SIZE) {			// last byte has been written
+		EECR &= ~(1<<EERIE);
+		ee_pos = EE_IDLE;
+		return;
+	}
+	i = (pos == EE_SLOT_SIZE - 1) ? 0 : pos + 1;	// sequence number last
+	EECR = (1<<EERIE);					// erase and write in one operation
+	EEAR = ee_addr + i;
+	EEDR = ee_buffer[i];
+	EECR |= (1<<EEMPE);
+	EECR |= (1<<EEPE);					// within 4 cycles after EEMPE
+	ee_pos = pos + 1;
+}
+#endif
+
+
+#ifdef PROTOCOUNTER_STATS
+void ProtoCounter::getStats(isr_stats_t* st)
+// copy the interrupt statistics (durations in timer1 counts, 1 us at 8 MHz)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		*st = stats;
+	}
+	st->update_mean = (st->update_mean + 4) >> 3;
+	st->analog_mean = (st->analog_mean + 4) >> 3;
+}
+
+
+void ProtoCounter::resetStats()
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		stats.update_max = 0;
+		stats.update_mean = 0;
+		stats.analog_max = 0;
+		stats.analog_mean = 0;
+		stats.overruns = 0;
+		stats.reentries = 0;
+	}
+}
+
+
+inline uint16_t ProtoCounter::readTimer1()
+// read TCNT1 (the 16 bit access must not be interrupted)
+{
+	uint16_t time;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		time = TCNT1;
+	}
+	return (time);
+}
+
+
+void ProtoCounter::recordTime(uint16_t* max, uint16_t* mean, uint16_t time)
+// update maximum and mean (exponential average with weight 1/8)
+{
+	if (time > *max) { *max = time; }
+	if (time > STATS_MAX_TIME) { time = STATS_MAX_TIME; }
+	*mean = *mean - (*mean >> 3) + time;
+}
+#endif
+
+
+#ifdef POWER_MANAGER
+void ProtoCounter::sleepIdle()
+// stop the cpu until the next interrupt (the display keeps running)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_mode();
+}
+
+
+void ProtoCounter::powerDown()
+// Stop cpu, timers and display until a button is pressed
+// or an input of the pulse counters / frequency meter changes.
+{
+	uint8_t pcmsk, timsk;
+
+	// Timer interrupts are masked until wake-up. Otherwise update() might
+	// drive the pins again before the cpu sleeps, and a pending timer
+	// interrupt would wake the cpu at once. (The timers stop anyway.)
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		timsk = TIMSK;
+		TIMSK = 0;
+	}
+
+	ANODE_PORT |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// all anodes off
+#ifdef SWAP_PINS_PD01_FOR_PB01
+	PORTD |= 0b01111100;	// all led segments off
+	PORTB |= 0b00000011;
+#else
+	PORTD = 0b01111111;		// all led segments off
+#endif
+#ifdef ANALOG_ENABLE
+	ACSR = (1<<ACD) | (1<<ACI);			// switch off analog comparator
+#endif
+
+	// prepare buttons for wake-up: button pins are inputs with pull-up,
+	// the common line is low (segments are off, so no led lights up)
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		BTN_DDR &= ~BTN_MASK;
+		BTN_PORT |= BTN_MASK;
+		BTN_PORT &= ~(1<<BTN_COM);
+		pcmsk = PCMSK;
+		PCMSK = pcmsk | BTN_MASK;
+		pin_level = PINB;
+	}
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	cli();
+	sleep_enable();
+	sei();								// the next instruction is executed before any interrupt
+	sleep_cpu();
+	sleep_disable();
+
+	// restore normal operation
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		PCMSK = pcmsk;
+		BTN_PORT |= (1<<BTN_COM);
+		BTN_DDR |= BTN_MASK;				// button pins are anode outputs again
+		TIMSK = timsk;
+	}
+#ifdef ANALOG_ENABLE
+	ACSR = ANALOG_ACSR;
+#endif
+	wakeDisplay();
+}
+
+
+void ProtoCounter::setDisplayTimeout(uint16_t timeout)
+// set time (number of update cycles) after which the display is blanked
+// if no button is pressed (0 = never)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		display_timeout = timeout;
+		idle_timer = 0;
+	}
+}
+
+
+void ProtoCounter::wakeDisplay()
+// turn display on and restart display timeout
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		idle_timer = 0;
+	}
+}
+
+
+uint8_t ProtoCounter::isDisplayOn()
+{
+	uint8_t on;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		on = (display_timeout == 0) || (idle_timer < display_timeout);
+	}
+	return (on);
+}
+#endif
+
+
+uint8_t ProtoCounter::getButton()
+// get button event
+{
+	return(button);
+}
+
+
+void ProtoCounter::buttonAck()
+// acknowledge button event
+{
+	button |= PB_ACK;					// set acknowledge flag
+}
+
+
+#ifdef BTN_EVENT_QUEUE
+uint8_t ProtoCounter::popButtonEvent(uint16_t* time)
+// Fetch the oldest button event from the queue (0 = queue empty).
+// If time is given, the tick count of the event is stored there.
+{
+	uint8_t tail, event;
+
+	tail = btn_queue_tail;
+	if (tail == btn_queue_head) { return (0); }
+	event = btn_queue_event[tail];
+	if (time) {
+		*time = btn_queue_time[tail];
+	}
+	btn_queue_tail = (tail + 1) & BTN_QUEUE_MASK;	// release entry
+	return (event);
+}
+#endif
+
+
+#ifdef TICK_COUNTER
+uint16_t ProtoCounter::getTicks()
+// return number of update() calls (wraps around)
+{
+	uint16_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = ticks;
+	}
+	return (temp);
+}
+#endif
+
+
+sr_in_data_t ProtoCounter::readShiftRegister()
+{
+	sr_in_data_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = sh_reg_in_data;
+	}
+	return(temp);
+}
+
+
+void ProtoCounter::writeShiftRegister(sr_out_data_t out_data)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+#ifdef SH_REG_BCM
+		for (uint8_t i = 0; i < SH_REG_BCM; i++) {
+			bcm_plane[i] = out_data;		// outputs fully on or off
+		}
+#endif
+#ifdef EXT_DIGITS
+		// the anodes of the extra digits are controlled by update()
+		out_data = (out_data & ~EXT_ANODE_MASK) | (sh_reg_out_data & EXT_ANODE_MASK);
+#endif
+#ifdef SH_REG_OUT_ON_CHANGE
+		if (sh_reg_out_data != out_data) {
+			sh_reg_out_data = out_data;
+			sh_reg_dirty = 1;				// request transfer
+		}
+#else
+		sh_reg_out_data = out_data;
+#endif
+	}
+}
+
+
+#ifdef SH_REG_BCM
+void ProtoCounter::setOutputDuty(uint8_t ch, uint8_t duty)
+// Set the duty value of an output (0 = off, 255 = on). Only the upper
+// SH_REG_BCM bits are used.
+{
+	sr_out_data_t mask;
+
+	if (ch >= SH_REG_OUT_BITCOUNT) { return; }
+	mask = (sr_out_data_t)1 << ch;
+	duty >>= (8 - SH_REG_BCM);
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		for (uint8_t i = 0; i < SH_REG_BCM; i++) {
+			if (duty & 1) {
+				bcm_plane[i] |= mask;
+			} else {
+				bcm_plane[i] &= ~mask;
+			}
+			duty >>= 1;
+		}
+	}
+}
+
+
+void ProtoCounter::setOutputDuties(const uint8_t* duty)
+// Set the duty values of all outputs at once (duty[0] = output 0, see
+// setOutputDuty()). The new values take effect together.
+{
+	sr_out_data_t plane[SH_REG_BCM];
+	uint8_t	ch, d, i;
+
+	for (i = 0; i < SH_REG_BCM; i++) {
+		plane[i] = 0;
+	}
+	ch = SH_REG_OUT_BITCOUNT;
+	do {								// build the bit planes, MSB first
+		ch--;
+		d = duty[ch] >> (8 - SH_REG_BCM);
+		for (i = 0; i < SH_REG_BCM; i++) {
+			plane[i] = (plane[i] << 1) | (d & 1);
+			d >>= 1;
+		}
+	} while (ch > 0);
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		for (i = 0; i < SH_REG_BCM; i++) {
+			bcm_plane[i] = plane[i];
+		}
+	}
+}
+#endif
+
+
+#ifdef SH_REG_DEBOUNCE
+sr_in_data_t ProtoCounter::readInputs()
+// return the debounced state of the shift register inputs
+{
+	sr_in_data_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = input_state;
+	}
+	return(temp);
+}
+
+
+sr_in_data_t ProtoCounter::getRisingEdges(sr_in_data_t mask)
+// Return the inputs (selected by mask) whose debounced state has changed
+// from 0 to 1 since the last call and clear these edges.
+{
+	sr_in_data_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = input_rising & mask;
+		input_rising &= ~mask;
+	}
+	return(temp);
+}
+
+
+sr_in_data_t ProtoCounter::getFallingEdges(sr_in_data_t mask)
+// Return the inputs (selected by mask) whose debounced state has changed
+// from 1 to 0 since the last call and clear these edges.
+{
+	sr_in_data_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = input_falling & mask;
+		input_falling &= ~mask;
+	}
+	return(temp);
+}
+
+
+inline sr_in_data_t ProtoCounter::debounceInputs()
+// Debounce all inputs at once with vertical counters: for every input that
+// differs from its debounced state the counter (cnt1:cnt0) counts 0, 3, 2, 1.
+// On the 4th differing sample in a row it reaches 0 again and the state
+// toggles. The counter of an input that equals its state is held at 0.
+// Returns the new rising edges.
+{
+	sr_in_data_t state = input_state;
+	sr_in_data_t delta = sh_reg_in_data ^ state;	// inputs that differ
+	sr_in_data_t toggle;
+
+	debounce_cnt1 = (debounce_cnt1 ^ ~debounce_cnt0) & delta;
+	debounce_cnt0 = ~debounce_cnt0 & delta;
+	toggle = delta & ~(debounce_cnt0 | debounce_cnt1);	// counter wrapped to 0
+	if (toggle) {
+		state ^= toggle;
+		input_state = state;
+		input_rising |= toggle & state;
+		input_falling |= toggle & ~state;
+	}
+	return (toggle & state);
+}
+#endif
+
+
+#ifdef SH_REG_COUNTERS
+uint32_t ProtoCounter::getInputCount(uint8_t ch)
+// return the number of rising edges counted on a shift register input
+{
+	uint32_t temp;
+
+	if (ch >= SH_REG_COUNTERS) { return (0); }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		flushCount(ch, (sr_in_data_t)1 << ch);
+		temp = count_total[ch];
+	}
+	return (temp);
+}
+
+
+uint32_t ProtoCounter::resetInputCount(uint8_t ch)
+// clear the count of a shift register input and return its last value
+{
+	uint32_t temp;
+
+	if (ch >= SH_REG_COUNTERS) { return (0); }
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		flushCount(ch, (sr_in_data_t)1 << ch);
+		temp = count_total[ch];
+		count_total[ch] = 0;
+	}
+	return (temp);
+}
+
+
+void ProtoCounter::flushCount(uint8_t ch, sr_in_data_t mask)
+// Move the count of a channel (mask = its bit) from the slices into its
+// total. Precondition: interrupts disabled (or called by update()).
+{
+	uint8_t	i = COUNT_SLICES;
+	uint8_t	n = 0;
+
+	do {
+		i--;
+		n <<= 1;
+		if (count_slice[i] & mask) {
+			count_slice[i] &= ~mask;
+			n |= 1;
+		}
+	} while (i > 0);
+	count_total[ch] += n;
+}
+
+
+inline void ProtoCounter::countInputs(sr_in_data_t edges)
+// Add 1 to the count of every channel with a bit set in edges. The slices
+// form a ripple carry adder for all channels at once: slice i toggles where
+// a carry arrives, the carry moves on where slice i has been 1 before.
+{
+	sr_in_data_t carry = edges & COUNT_MASK;
+	sr_in_data_t overflow;
+	uint8_t	i;
+
+	for (i = 0; carry && (i < COUNT_SLICES); i++) {
+		overflow = count_slice[i] & carry;
+		count_slice[i] ^= carry;
+		carry = overflow;
+	}
+
+	// move one channel into its total (round robin)
+	flushCount(count_flush, count_flush_mask);
+	count_flush++;
+	count_flush_mask <<= 1;
+	if (count_flush >= SH_REG_COUNTERS) {
+		count_flush = 0;
+		count_flush_mask = 1;
+	}
+}
+#endif
+
+
+void ProtoCounter::updateShiftRegister()
+// shift out data to external shift registers (MSB first)
+// shift in data from external shift registers (MSB first)
+// precondition: IN, OUT and CLK pins must be high
+{
+#if (SH_REG_IN_BITCOUNT > 0) || (SH_REG_OUT_BITCOUNT > 0)
+
+	PROBE_START(PROBE_SH_REG);
+
+#if SH_REG_OUT_BITCOUNT > SH_REG_IN_BITCOUNT
+	sr_out_data_t	sr_data;
+#else
+	sr_in_data_t	sr_data;
+#endif
+
+#ifdef SH_REG_USI
+	// The USI transfers one byte at a time. Output data is right aligned:
+	// leading padding bits drop off the end of the output chain. Input data
+	// arrives left aligned.
+	// USCK (PB7) also drives anode 1, so the display multiplexing clocks the
+	// input chain between two calls. Therefore the inputs are shifted in by a
+	// separate transfer right after they have been loaded.
+	uint8_t	n, i;
+
+#ifdef SH_REG_OUT_ON_CHANGE
+	sh_reg_dirty = 0;
+#endif
+	SH_REG_DDR &= ~(1<<SH_REG_IN_BIT);				// make IN (DI) an input
+#if SH_REG_OUT_BITCOUNT > 0							// ----- shift data out -----
+	sr_data = sh_reg_out_data;
+	for (n = 0; n < SH_REG_USI_OUT_BYTES; n++) {
+		USIDR = (uint8_t)(sr_data >> ((SH_REG_USI_OUT_BYTES - 1) * 8));
+		for (i = 0; i < 8; i++) {					// 2 clock edges per bit
+			USICR = USI_CLOCK_STROBE;
+			USICR = USI_CLOCK_STROBE;
+		}
+		sr_data <<= 8;
+	}
+	// turn anode off to avoid ghost images
+	SH_REG_PORT |=  (1<<SH_REG_OUT_BIT);			// set OUT = high
+	USICR = 0;										// return DO to port control
+#endif
+
+	// load outputs and sample inputs
+	SH_REG_LD_PORT &= ~(1<<SH_REG_LD_BIT);
+	SH_REG_LD_PORT |=  (1<<SH_REG_LD_BIT);
+
+#if SH_REG_IN_BITCOUNT > 0							// ----- shift data in -----
+	sr_data = 0;
+	for (n = 0; n < SH_REG_USI_IN_BYTES; n++) {
+		USIDR = 0xFF;								// keep DO (anode) high
+		for (i = 0; i < 8; i++) {
+			USICR = USI_CLOCK_STROBE;
+			USICR = USI_CLOCK_STROBE;
+		}
+		sr_data = (sr_data << 8) | USIDR;
+	}
+	USICR = 0;
+	sh_reg_in_data = (sr_data >> (SH_REG_USI_IN_BYTES * 8 - SH_REG_IN_BITCOUNT)) & SH_REG_IN_MASK;
+#endif
+	SH_REG_DDR |= (1<<SH_REG_IN_BIT);				// switch IN back to output
+
+#else
+
+	uint8_t 		bit;
+
+#ifdef SH_REG_OUT_ON_CHANGE
+	sh_reg_dirty = 0;
+#endif
+#if SH_REG_OUT_BITCOUNT > 0							// ----- shift data out -----
+	sr_data = sh_reg_out_data;
+	for (bit = 0; bit < SH_REG_OUT_BITCOUNT; bit++) {
+		if (sr_data & SH_REG_MSB_MASK) {			// set OUT = MSB
+			SH_REG_PORT |=  (1<<SH_REG_OUT_BIT);
+		} else {
+			SH_REG_PORT &= ~(1<<SH_REG_OUT_BIT);
+		}
+		sr_data <<= 1;
+		SH_REG_PORT &= ~(1<<SH_REG_CLK_BIT);		// clock pulse
+		SH_REG_PORT |=  (1<<SH_REG_CLK_BIT);
+	}
+	// turn anode off to avoid ghost images
+	SH_REG_PORT |=  (1<<SH_REG_OUT_BIT);			// set OUT = high
+#endif
+
+	// load outputs and sample inputs
+	SH_REG_LD_PORT &= ~(1<<SH_REG_LD_BIT);
+	SH_REG_LD_PORT |=  (1<<SH_REG_LD_BIT);
+
+#if SH_REG_IN_BITCOUNT > 0							// ----- shift data in -----
+	sr_data = 0;
+	SH_REG_DDR &= ~(1<<SH_REG_IN_BIT);				// make IN an input
+	for (bit = 0; bit < SH_REG_IN_BITCOUNT; bit++) {
+		sr_data <<= 1;
+		if (SH_REG_PIN & (1<<SH_REG_IN_BIT)) {		// set LSB = IN
+			sr_data |= 1;
+		}
+		SH_REG_PORT &= ~(1<<SH_REG_CLK_BIT);		// clock pulse
+		SH_REG_PORT |=  (1<<SH_REG_CLK_BIT);
+	}
+	sh_reg_in_data = sr_data;
+	SH_REG_DDR |= (1<<SH_REG_IN_BIT);				// switch IN back to output
+#endif
+
+#endif /* SH_REG_USI */
+
+#if defined(SH_REG_DEBOUNCE) && defined(SH_REG_COUNTERS)
+	countInputs(debounceInputs());					// count debounced rising edges
+#elif defined(SH_REG_DEBOUNCE)
+	debounceInputs();
+#elif defined(SH_REG_COUNTERS)
+	countInputs(sh_reg_in_data & ~count_last);		// count rising edges
+	count_last = sh_reg_in_data;
+#endif
+	PROBE_STOP(PROBE_SH_REG);
+#endif
+}
+
+
+void ProtoCounter::sampleButtons()
+// precondition: all button pins must be high
+{
+	uint8_t pb;
+#ifdef BTN_EVENT_QUEUE
+	uint8_t last_event = button & ~PB_ACK;
+#endif
+
+	PROBE_START(PROBE_BUTTONS);
+
+	// sample push buttons
+	BTN_DDR &= ~(1 << BTN1_BIT);				// switch button pins to input
+	BTN_DDR &= ~(1 << BTN2_BIT);
+
+	BTN_PORT &= ~(1<<BTN_COM);					// set common line = low
+
+#ifdef ARDUINO
+	delayMicroseconds(1);
+#else
+	_delay_us(1);
+#endif
+
+	pb = ~BTN_PIN;								// read buttons
+	pb &= BTN_MASK;
+#ifdef POWER_MANAGER
+	if (pb) { idle_timer = 0; }					// button activity
+#endif
+	BTN_PORT |= (1<<BTN_COM);					// set common line = high
+	BTN_DDR |= (1 << BTN1_BIT);					// switch back to outputs
+	BTN_DDR |= (1 << BTN2_BIT);
+
+	if (pb == 0) {								// --- no button pressed ---
+		if (button & PB_PRESS) {				// former state = pressed ?
+			if ((button & (PB_ACK|PB_LONG)) == (PB_ACK|PB_LONG)) {	// in case of an acknowledged longpress event
+				button &= ~(PB_ACK | PB_PRESS);		// -> issue long release event (clear ack and press)
+			} else {
+				button &= ~(PB_ACK | PB_LONGPRESS);	// -> issue release event (clear ack, long and press)
+			}
+		}
+	}
+	else {										// --- button pressed ---
+		if ((button & PB_PRESS) == 0) {			// former state = all buttons released ?
+			button = pb | PB_PRESS;				// -> issue press event
+			// start push button timer
+			pb_delay_timer = BTN_LONGPRESS_DELAY;
+		} else {
+			if ((button & (BTN_MASK|PB_LONG)) == pb) {	// holding same button pressed?
+				if (pb_delay_timer == 0) {			// if push button timer has elapsed
+					button = pb | PB_LONGPRESS;	// issue longpress event
+				}
+			} else {
+				if ((pb == BOTH_BTNS) && ((button & PB_LONG) == 0)) {
+					button = BOTH_PRESSED;		// -> issue "both pressed" event
+				}
+			}
+		}
+	}
+	if (pb_delay_timer) { pb_delay_timer--; }
+
+#ifdef BTN_EVENT_QUEUE
+	pb = button & ~PB_ACK;
+	if (pb != last_event) {						// new event -> put into queue
+		uint8_t head = btn_queue_head;
+		uint8_t next = (head + 1) & BTN_QUEUE_MASK;
+		if (next != btn_queue_tail) {			// drop event if queue is full
+			btn_queue_event[head] = pb;
+			btn_queue_time[head] = ticks;
+			btn_queue_head = next;				// publish entry
+		}
+	}
+#endif
+
+	PROBE_STOP(PROBE_BUTTONS);
+}
+
+
+void ProtoCounter::update()
+// should be called periodically, e. g. every 1 ms
+{
+	static uint8_t current_pos = 0;
+	static const uint8_t col_bit[MAX_DIGITS] PROGMEM =
+								{(1<<ANODE3), (1<<ANODE2), (1<<ANODE1)};
+	uint8_t	anode;
+#ifdef PROTOCOUNTER_STATS
+	uint16_t stats_start = readTimer1();
+
+	if (stats_depth) {							// update() has been interrupted by itself
+		stats.reentries++;
+	}
+	stats_depth++;
+#ifdef STATS_DEBUG_BIT
+	STATS_DEBUG_PORT |= (1<<STATS_DEBUG_BIT);
+#endif
+#endif
+
+	PROBE_START(PROBE_UPDATE);
+
+#ifdef TICK_COUNTER
+#ifdef FREQ_METER
+	// Timer0 compare A latches the compare point of update() until it has
+	// been counted. Unlike OCF0B it is not cleared by entering the interrupt
+	// routine, so timeStamp() knows whether ticks is up to date.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ticks++;
+		OCR0A = OCR0B;
+		TIFR = (1<<OCF0A);
+	}
+#else
+	ticks++;
+#endif
+#endif
+#ifdef SOFT_TIMERS
+	updateTimers();
+#endif
+
+#ifdef MUX_TIMER1
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		TIMSK &= ~(1<<OCIE1B);					// no end of on-time during i/o
+	}
+#endif
+	ANODE_PORT |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// all anodes off
+
+#ifdef SWAP_PINS_PD01_FOR_PB01
+	PORTD |= 0b01111100;	// all led segments off
+	PORTB |= 0b00000011;
+#else
+	PORTD = 0b01111111;		// all led segments off
+#endif
+
+#ifdef ANALOG_ENABLE
+	if (current_pos == 0) {
+		ACSR = ANALOG_ACSR | (1<<ACIE);		// enable analog comparator interrupt
+		AIN1_DDR &= ~(1<<AIN1_BIT);			// make AIN1 input (without pull-up)
+#ifdef ANALOG_HIGH_RES
+		start_time = TCNT1;					// remember start time
+#else
+		start_time = TCNT0;					// remember start time
+#endif
+	}
+	else {
+		AIN1_DDR |= (1<<AIN1_BIT);			// output LOW on AIN1 to discharge capacitor
+	}
+#endif
+
+#ifdef SH_REG_BCM
+	// binary code modulation: bit plane k is shown for 2^k update cycles
+	if (bcm_timer == 0) {
+		bcm_slot++;
+		if (bcm_slot >= SH_REG_BCM) { bcm_slot = 0; }
+		bcm_timer = 1 << bcm_slot;
+		sh_reg_out_data = bcm_plane[bcm_slot];
+	}
+	bcm_timer--;
+#endif
+
+#ifdef EXT_DIGITS
+	{
+		// The anode of an extra digit is switched by the shift register
+		// transfer below (while all segments are off), so select the
+		// anode of the position that comes next.
+		uint8_t next_pos = (current_pos ? current_pos : (MAX_DIGITS+1 + DIMMING_LEVEL)) - 1;
+		sr_out_data_t ext_anodes = EXT_ANODE_MASK;	// all extra anodes off
+
+#ifdef POWER_MANAGER
+		if ((next_pos >= 3) && (next_pos < MAX_DIGITS) && ((display_timeout == 0) || (idle_timer < display_timeout))) {
+#else
+		if ((next_pos >= 3) && (next_pos < MAX_DIGITS)) {
+#endif
+			ext_anodes ^= EXT_ANODE_LSB << (next_pos - 3);
+		}
+		sh_reg_out_data = (sh_reg_out_data & ~EXT_ANODE_MASK) | ext_anodes;
+	}
+#endif
+
+#if (SH_REG_IN_BITCOUNT > 0) || (SH_REG_OUT_BITCOUNT > 0)
+#if ((SH_REG_INTERVAL == 1) && !defined(SH_REG_OUT_ON_CHANGE)) || defined(EXT_DIGITS) || defined(SH_REG_BCM)
+	updateShiftRegister();
+#else
+	{
+#if SH_REG_INTERVAL > 0
+		static uint8_t sh_reg_timer = 0;
+#endif
+		uint8_t refresh = 0;
+
+#if SH_REG_INTERVAL > 0
+		if (sh_reg_timer == 0) {				// fixed refresh rate
+			sh_reg_timer = SH_REG_INTERVAL;
+			refresh = 1;
+		}
+		sh_reg_timer--;
+#endif
+#ifdef SH_REG_OUT_ON_CHANGE
+		if (sh_reg_dirty) {						// output data has changed
+			refresh = 1;
+		}
+#endif
+		if (refresh) {
+			updateShiftRegister();
+		}
+	}
+#endif
+#endif
+
+#ifdef COUNTER_CHANNELS
+	for (uint8_t ch = 0; ch < COUNTER_CHANNELS; ch++) {
+		if (counter_timer[ch]) { counter_timer[ch]--; }	// deadtime
+	}
+#endif
+
+#ifdef FREQ_METER
+	freq_timer++;
+	if (freq_timer >= FREQ_GATE_TIME) {			// end of gate time
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			if (freq_edges >= 2) {				// at least one full period
+				freq_periods = freq_edges - 1;
+				freq_time = (freq_last - freq_first) & FREQ_TIME_MASK;
+				freq_first = freq_last;			// last edge starts next gate
+				freq_edges = 1;
+				freq_timer = 0;
+			}
+			else if (freq_timer >= FREQ_TIMEOUT) {	// no signal
+				freq_periods = 0;
+				freq_edges = 0;
+				freq_timer = 0;
+			}
+		}
+	}
+	else if (freq_edges >= FREQ_MAX_EDGES) {	// very high frequency
+		freq_timer = FREQ_GATE_TIME - 1;		// -> end gate in next cycle
+	}
+#endif
+
+#ifdef POWER_MANAGER
+	if (display_timeout && (idle_timer < display_timeout)) {
+		idle_timer++;
+	}
+#endif
+
+#ifdef RATE_BINS
+	rate_timer--;
+	if (rate_timer == 0) {						// end of bin
+		rate_timer = RATE_BIN_TIME;
+		updateRate();
+	}
+#endif
+
+#ifdef MARQUEE
+	if (marquee_timer) {
+		marquee_timer--;
+		if (marquee_timer == 0) {
+			marquee_timer = marquee_speed;
+			marquee_due = 1;
+		}
+	}
+#endif
+
+	pb_timer--;
+	if (pb_timer == 0) {
+		pb_timer = BTN_SAMPLE_INTERVAL;
+		sampleButtons();
+	}
+
+	if (current_pos == 0) {
+		current_pos = (MAX_DIGITS+1 + DIMMING_LEVEL);	// add an extra cycle for analog reading
+#ifdef DISPLAY_DOUBLE_BUFFER
+		if (frame_pending) {					// frame boundary: show new frame
+			uint8_t* temp = front;
+			front = back;
+			back = temp;
+			frame_pending = 0;
+		}
+#endif
+#ifdef MARQUEE
+		if (marquee_due) {						// next marquee step is due
+			marquee_due = 0;
+			scrollMarquee();
+		}
+#endif
+	}
+
+	current_pos--;								// next position
+#ifdef POWER_MANAGER
+	if ((current_pos < MAX_DIGITS) && ((display_timeout == 0) || (idle_timer < display_timeout))) {
+#else
+	if (current_pos < MAX_DIGITS) {
+#endif
+		anode = pgm_read_byte( &col_bit[current_pos] );
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			ANODE_PORT &= ~anode;				// turn new anode on
+#ifdef MUX_TIMER1
+			uint16_t off_time = TCNT1;
+			if (off_time == MUX_TOP) {			// timer1 clears with its next clock
+				off_time = 0;
+			}
+			off_time += mux_on_time;
+			if (off_time <= MUX_TOP) {			// schedule end of on-time
+				OCR1B = off_time;
+				TIFR = (1<<OCF1B);
+				TIMSK |= (1<<OCIE1B);
+			}
+#endif
+		}
+		
+#ifdef SWAP_PINS_PD01_FOR_PB01
+		PORTD |= 0b11111100;					// set led segments
+		PORTD &= (DISPLAY_FRONT[current_pos] | 0b00000011);
+		PORTB |= 0b00000011;
+		PORTB &= (DISPLAY_FRONT[current_pos] | 0b11111100);
+#else
+		PORTD = DISPLAY_FRONT[current_pos];		// set led segments
+#endif
+	}
+
+	PROBE_STOP(PROBE_UPDATE);
+
+#ifdef PROTOCOUNTER_STATS
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		uint16_t time = TCNT1 - stats_start;
+#ifdef MUX_TIMER1
+		if (TIFR & (1<<OCF1A)) {				// next update cycle is already due
+			stats.overruns++;
+		}
+		if (time > MUX_TOP) {					// timer1 has been cleared in between
+			time += MUX_TOP + 1;				// (measured modulo the update cycle)
+		}
+#else
+		if (time > STATS_CYCLE) {
+			stats.overruns++;
+		}
+#endif
+		recordTime(&stats.update_max, &stats.update_mean, time);
+		stats_depth--;
+#ifdef STATS_DEBUG_BIT
+		if (stats_depth == 0) {
+			STATS_DEBUG_PORT &= ~(1<<STATS_DEBUG_BIT);
+		}
+#endif
+	}
+#endif
+}
+
+
+uint8_t ProtoCounter::getAnalog()
+{
+#ifdef ANALOG_HIGH_RES
+	uint16_t raw, span, pos, lower;
+	uint8_t  val;
+
+	if (ANALOG_RES >= ANALOG_OFF) {
+		analog = 0;
+		return (0);
+	}
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		raw = analog_raw;
+	}
+
+	// apply calibration
+	span = analog_max - analog_min;
+	raw = (raw > analog_min) ? (raw - analog_min) : 0;
+	if (raw > span) { raw = span; }
+
+	// position in 1/16 steps (at most 16 * top + 15, see calibrateAnalog())
+	pos = ((uint32_t)raw * analog_scale) >> 8;
+
+	// change value only if the position is more than 1/4 step outside
+	val = analog;
+	lower = (uint16_t)val << 4;
+	if ((pos + 4 < lower) || (pos >= lower + 20)) {
+		val = (uint8_t)(pos >> 4);
+		analog = val;
+	}
+	return (val);
+#else
+	return (analog);
+#endif
+}
+
+
+#ifdef ANALOG_ENABLE
+void ProtoCounter::calibrateAnalog()
+// Precompute the scale factor of the selected resolution (and calibration),
+// so converting a measurement takes a single multiplication.
+{
+#ifdef ANALOG_HIGH_RES
+	// largest value for each resolution
+	static const uint8_t analog_top[ANALOG_OFF] PROGMEM = {255, 128, 85, 64, 42, 32, 21};
+	uint32_t scale = 0;
+
+	// rounded down, so the end of the calibrated range gives at most top
+	if (ANALOG_RES < ANALOG_OFF) {
+		scale = ((pgm_read_byte( &analog_top[ANALOG_RES] ) + 1UL) * 16 * 256 - 1)
+			  / (analog_max - analog_min);
+		if (scale > 0xFFFF) { scale = 0xFFFF; }
+	}
+	analog_scale = (uint16_t)scale;
+#else
+	// factor for the ramp-up time (1/16) of each resolution,
+	// ANALOG_MAX_RESOLUTION uses the time directly
+	static const uint8_t analog_factor[ANALOG_OFF] PROGMEM = {16, 24, 16, 12, 8, 6, 4};
+
+	if (ANALOG_RES < ANALOG_OFF) {
+		analog_scale = pgm_read_byte( &analog_factor[ANALOG_RES] );
+	}
+#endif
+}
+#endif
 
-	writeChar('h', 0);				// write 'h' to indicate a hex number
+
+#ifdef ANALOG_HIGH_RES
+uint16_t ProtoCounter::getAnalogRaw()
+// return duration of the last analog ramp-up (timer1 counts)
+{
+	uint16_t temp;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = analog_raw;
+	}
+	return (temp);
 }
 
 
-void ProtoCounter::setDimming(uint8_t dim)
-// set dimming level (0 = no dimming)
+void ProtoCounter::setAnalogCalibration(uint16_t raw_min, uint16_t raw_max)
+// set raw counts that correspond to both ends of the knob
 {
-	dimming = dim;
+	if (raw_max > raw_min) {
+		analog_min = raw_min;
+		analog_max = raw_max;
+		calibrateAnalog();
+	}
 }
+#endif
 
 
-void ProtoCounter::setDecimalPlaces(uint8_t decimals)
+#ifdef COUNTER_CHANNELS
+int32_t ProtoCounter::getCounter(uint8_t ch)
+// return number of pulses counted on channel ch
 {
-	if (decimals < MAX_DIGITS) {
-		decimal_places = decimals;
+	int32_t temp = 0;
+
+	if (ch < COUNTER_CHANNELS) {
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			temp = counter[ch];
+		}
 	}
+	return (temp);
 }
 
 
-void ProtoCounter::setAnalogResolution(uint8_t ana_res)
+int32_t ProtoCounter::resetCounter(uint8_t ch)
+// set counter of channel ch to zero and return its former value
 {
-	if (ana_res <= ANALOG_OFF) {
-		analog_resolution = ana_res;
+	int32_t temp = 0;
+
+	if (ch < COUNTER_CHANNELS) {
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			temp = counter[ch];
+			counter[ch] = 0;
+		}
 	}
+	return (temp);
 }
 
 
-uint8_t ProtoCounter::getButton()
-// get button event
+void ProtoCounter::addCounter(uint8_t ch, int32_t val)
+// add a (positive or negative) value to the counter of channel ch
 {
-	return(button);
+	if (ch < COUNTER_CHANNELS) {
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			counter[ch] += val;
+		}
+	}
 }
 
 
-void ProtoCounter::buttonAck()
-// acknowledge button event
+void ProtoCounter::setCounterDeadtime(uint8_t ch, uint8_t deadtime)
+// set deadtime of channel ch (number of update cycles)
 {
-	button |= PB_ACK;					// set acknowledge flag
+	if (ch < COUNTER_CHANNELS) {
+		counter_deadtime[ch] = deadtime;
+	}
 }
+#endif
 
 
-sr_in_data_t ProtoCounter::readShiftRegister()
+#ifdef FREQ_METER
+uint32_t ProtoCounter::getFrequency()
+// return frequency in mHz (0 = no signal)
 {
-	sr_in_data_t temp;
+	uint16_t periods;
+	uint32_t time, a, f, r;
+	static const uint8_t factor[] = {8, 10, 10, 10};
 
 	ATOMIC_BLOCK(ATOMIC_FORCEON) {
-		temp = sh_reg_in_data;
+		periods = freq_periods;
+		time = freq_time;
 	}
-	return(temp);
+	if ((periods == 0) || (time == 0)) { return (0); }
+
+	// f = periods * 1000 * FREQ_COUNTS_PER_S / time
+	// The product does not fit into 32 bits, so the division is carried
+	// out step by step (1000 * FREQ_COUNTS_PER_S = 8 * 10 * 10 * 10 * a).
+	a = (uint32_t)periods * (FREQ_COUNTS_PER_S / 8);
+	f = a / time;
+	r = a % time;
+	for (uint8_t i = 0; i < sizeof(factor); i++) {
+		r *= factor[i];
+		f = f * factor[i] + r / time;
+		r %= time;
+	}
+	return (f);
 }
 
 
-void ProtoCounter::writeShiftRegister(sr_out_data_t out_data)
+uint32_t ProtoCounter::getPeriod()
+// return period in us (0 = no signal)
 {
+	uint16_t periods;
+	uint32_t time;
+
 	ATOMIC_BLOCK(ATOMIC_FORCEON) {
-		sh_reg_out_data = out_data;
+		periods = freq_periods;
+		time = freq_time;
 	}
+	if (periods == 0) { return (0); }
+	return ((time * (64000000UL / F_CPU)) / periods);
 }
 
 
-void ProtoCounter::updateShiftRegister()
-// shift out data to external shift registers (MSB first)
-// shift in data from external shift registers (MSB first)
-// precondition: IN, OUT and CLK pins must be high
+void ProtoCounter::writeFrequency()
+// display frequency in Hz with the decimal places that fit
+// (auto-ranging, see writeFixed())
 {
-#if (SH_REG_IN_BITCOUNT > 0) || (SH_REG_OUT_BITCOUNT > 0)
+	writeFixed(getFrequency(), 3);
+}
 
-	uint8_t 		bit;
 
-#if SH_REG_OUT_BITCOUNT > SH_REG_IN_BITCOUNT
-	sr_out_data_t	sr_data;
-#else
-	sr_in_data_t	sr_data;
-#endif
+inline uint32_t ProtoCounter::timeStamp()
+// Time stamp with a resolution of one timer0 count. update() is called on
+// the timer0 compare B match, so the tick counter holds the upper bits.
+// OCF0A is set at the same match and cleared by update() together with
+// counting the tick, so it tells whether ticks has been counted yet (also
+// between entering the interrupt routine and the call of update()).
+{
+	uint8_t  cnt;
+	uint16_t t;
 
-#if SH_REG_OUT_BITCOUNT > 0							// ----- shift data out -----
-	sr_data = sh_reg_out_data;
-	for (bit = 0; bit < SH_REG_OUT_BITCOUNT; bit++) {
-		if (sr_data & SH_REG_MSB_MASK) {			// set OUT = MSB
-			SH_REG_PORT |=  (1<<SH_REG_OUT_BIT);
-		} else {
-			SH_REG_PORT &= ~(1<<SH_REG_OUT_BIT);
-		}
-		sr_data <<= 1;
-		SH_REG_PORT &= ~(1<<SH_REG_CLK_BIT);		// clock pulse
-		SH_REG_PORT |=  (1<<SH_REG_CLK_BIT);
+	cnt = TCNT0 - OCR0B;						// timer counts since last update()
+	t = ticks;
+	if ((TIFR & (1<<OCF0A)) && (cnt < 128)) {	// compare match not yet counted by update()
+		t++;
 	}
-	// turn anode off to avoid ghost images
-	SH_REG_PORT |=  (1<<SH_REG_OUT_BIT);			// set OUT = high
+	return (((uint32_t)t << 8) | cnt);
+}
 #endif
 
-	// load outputs and sample inputs
-	SH_REG_LD_PORT &= ~(1<<SH_REG_LD_BIT);
-	SH_REG_LD_PORT |=  (1<<SH_REG_LD_BIT);
 
-#if SH_REG_IN_BITCOUNT > 0							// ----- shift data in -----
-	sr_data = 0;
-	SH_REG_DDR &= ~(1<<SH_REG_IN_BIT);				// make IN an input
-	for (bit = 0; bit < SH_REG_IN_BITCOUNT; bit++) {
-		sr_data <<= 1;
-		if (SH_REG_PIN & (1<<SH_REG_IN_BIT)) {		// set LSB = IN
-			sr_data |= 1;
-		}
-		SH_REG_PORT &= ~(1<<SH_REG_CLK_BIT);		// clock pulse
-		SH_REG_PORT |=  (1<<SH_REG_CLK_BIT);
-	}
-	sh_reg_in_data = sr_data;
-	SH_REG_DDR |= (1<<SH_REG_IN_BIT);				// switch IN back to output
-#endif
+#ifdef ENCODER
+int32_t ProtoCounter::getEncoder()
+// Return the encoder position at the selected resolution. The quarter
+// steps are rounded, so the position changes halfway between two counts
+// in both directions.
+{
+	int32_t steps;
+	uint8_t res = encoder_resolution;
 
-#endif
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		steps = encoder_steps;
+	}
+	return ((steps + ((1 << res) >> 1)) >> res);
 }
 
 
-void ProtoCounter::sampleButtons()
-// precondition: all button pins must be high
+int32_t ProtoCounter::resetEncoder()
+// Set the encoder position to 0 and return its last value.
+// The fraction of a count is kept, so the position stays aligned
+// with the detents.
 {
-	uint8_t pb;
+	int32_t steps, pos;
+	uint8_t res = encoder_resolution;
 
-	// sample push buttons
-	BTN_DDR &= ~(1 << BTN1_BIT);				// switch button pins to input
-	BTN_DDR &= ~(1 << BTN2_BIT);
-
-	BTN_PORT &= ~(1<<BTN_COM);					// set common line = low
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		steps = encoder_steps;
+		pos = (steps + ((1 << res) >> 1)) >> res;
+		encoder_steps = steps - pos * (1 << res);
+	}
+	return (pos);
+}
 
-#ifdef ARDUINO
-	delayMicroseconds(1);
-#else
-	_delay_us(1);
-#endif
 
-	pb = ~BTN_PIN;								// read buttons
-	pb &= BTN_MASK;
-	BTN_PORT |= (1<<BTN_COM);					// set common line = high
-	BTN_DDR |= (1 << BTN1_BIT);					// switch back to outputs
-	BTN_DDR |= (1 << BTN2_BIT);
+uint16_t ProtoCounter::getEncoderErrors()
+// return the number of illegal transitions since the last call
+{
+	uint16_t temp;
 
-	if (pb == 0) {								// --- no button pressed ---
-		if (button & PB_PRESS) {				// former state = pressed ?
-			if ((button & (PB_ACK|PB_LONG)) == (PB_ACK|PB_LONG)) {	// in case of an acknowledged longpress event
-				button &= ~(PB_ACK | PB_PRESS);		// -> issue long release event (clear ack and press)
-			} else {
-				button &= ~(PB_ACK | PB_LONGPRESS);	// -> issue release event (clear ack, long and press)
-			}
-		}
-	}
-	else {										// --- button pressed ---
-		if ((button & PB_PRESS) == 0) {			// former state = all buttons released ?
-			button = pb | PB_PRESS;				// -> issue press event
-			// start push button timer
-			pb_delay_timer = BTN_LONGPRESS_DELAY;
-		} else {
-			if ((button & (BTN_MASK|PB_LONG)) == pb) {	// holding same button pressed?
-				if (pb_delay_timer == 0) {			// if push button timer has elapsed
-					button = pb | PB_LONGPRESS;	// issue longpress event
-				}
-			} else {
-				if ((pb == BOTH_BTNS) && ((button & PB_LONG) == 0)) {
-					button = BOTH_PRESSED;		// -> issue "both pressed" event
-				}
-			}
-		}
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		temp = encoder_errors;
+		encoder_errors = 0;
 	}
-	if (pb_delay_timer) { pb_delay_timer--; }
+	return (temp);
 }
 
 
-void ProtoCounter::update()
-// should be called periodically, e. g. every 1 ms
+void ProtoCounter::setEncoderResolution(uint8_t res)
+// set the resolution (ENCODER_4X, ENCODER_2X or ENCODER_1X)
 {
-	static uint8_t current_pos = 0;
-	static const uint8_t col_bit[MAX_DIGITS] PROGMEM =
-								{(1<<ANODE3), (1<<ANODE2), (1<<ANODE1)};
-	uint8_t	anode;
+	if (res <= ENCODER_1X) {
+		encoder_resolution = res;
+#ifdef ENCODER_DISPLAY
+		encoder_changed = 1;
+#endif
+	}
+}
 
-	ANODE_PORT |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// all anodes off
 
-#ifdef SWAP_PINS_PD01_FOR_PB01
-	PORTD |= 0b01111100;	// all led segments off
-	PORTB |= 0b00000011;
-#else
-	PORTD = 0b01111111;		// all led segments off
-#endif
+void ProtoCounter::writeEncoder()
+// display the encoder position (see writeLong())
+{
+	writeLong(getEncoder());
+}
 
-#ifdef ANALOG_ENABLE
-	if (current_pos == 0) {
-		ACSR = (1<<ACBG) | (1<<ACI)| (1<<ACIE)| (2<<ACIS0);	// enable analog comparator interrupt
-		AIN1_DDR &= ~(1<<AIN1_BIT);			// make AIN1 input (without pull-up)
-		start_time = TCNT0;					// remember start time
-	}
-	else {
-		AIN1_DDR |= (1<<AIN1_BIT);			// output LOW on AIN1 to discharge capacitor
-	}
-#endif
 
-#if (SH_REG_IN_BITCOUNT > 0) || (SH_REG_OUT_BITCOUNT > 0)
-	updateShiftRegister();
+#ifdef ENCODER_DISPLAY
+uint8_t ProtoCounter::pollEncoder()
+// Display the encoder position if it has changed since the last call.
+// Returns 1 if the display has been written, otherwise 0.
+{
+	if (encoder_changed == 0) { return (0); }
+	encoder_changed = 0;						// clear first, a step in between sets it again
+	writeEncoder();
+	return (1);
+}
+#endif
 #endif
 
-	pb_timer--;
-	if (pb_timer == 0) {
-		pb_timer = BTN_SAMPLE_INTERVAL;
-		sampleButtons();
-	}
 
-	if (current_pos == 0) {
-		current_pos = (MAX_DIGITS+1 + dimming);	// add an extra cycle for analog reading
-	}
+#ifdef PIN_CHANGE_INT
+inline void ProtoCounter::pinChange()
+// evaluate a level change on the port B pins
+// (with POWER_MANAGER alone the interrupt only serves for wake-up)
+{
+	uint8_t level;
 
-	current_pos--;								// next position
-	if (current_pos < MAX_DIGITS) {
-		anode = pgm_read_byte( &col_bit[current_pos] );
-		ATOMIC_BLOCK(ATOMIC_FORCEON) {
-			ANODE_PORT &= ~anode;				// turn new anode on
+	level = PINB;
+#if defined(COUNTER_CHANNELS) || defined(FREQ_METER)
+	uint8_t falling = pin_level & ~level;		// pins with a high-to-low transition
+#endif
+	pin_level = level;
+
+#ifdef ENCODER
+	// transitions (old A, B -> new A, B): quarter steps (forward sequence
+	// 00, 01, 11, 10) or illegal transition
+	static const int8_t encoder_table[16] PROGMEM = {
+		 0, +1, -1, ENCODER_ILLEGAL,
+		-1,  0, ENCODER_ILLEGAL, +1,
+		+1, ENCODER_ILLEGAL,  0, -1,
+		ENCODER_ILLEGAL, -1, +1,  0
+	};
+	uint8_t state = ENCODER_STATE(level);
+
+	if (state != encoder_state) {
+		int8_t step = pgm_read_byte( &encoder_table[(encoder_state << 2) | state] );
+		encoder_state = state;
+		if (step == ENCODER_ILLEGAL) {
+			if (encoder_errors < 0xFFFF) { encoder_errors++; }
 		}
-		
-#ifdef SWAP_PINS_PD01_FOR_PB01
-		PORTD |= 0b11111100;					// set led segments
-		PORTD &= (display[current_pos] | 0b00000011);
-		PORTB |= 0b00000011;
-		PORTB &= (display[current_pos] | 0b11111100);
-#else
-		PORTD = display[current_pos];			// set led segments
+		else {
+			encoder_steps += step;
+#ifdef ENCODER_DISPLAY
+			encoder_changed = 1;
 #endif
+		}
 	}
-}
+#endif
 
+#ifdef FREQ_METER
+	if (falling & (1<<FREQ_BIT)) {
+		uint32_t ts = timeStamp();
+		if (freq_edges == 0) {
+			freq_first = ts;					// start of measurement
+		}
+		freq_last = ts;
+		freq_edges++;
+	}
+#endif
 
-uint8_t ProtoCounter::getAnalog()
-{
-	return (analog);
+#ifdef COUNTER_CHANNELS
+	if (falling & COUNTER_MASK) {
+		uint8_t bit = (1 << COUNTER_FIRST_BIT);
+		for (uint8_t ch = 0; ch < COUNTER_CHANNELS; ch++) {
+			if ((falling & bit) && (counter_timer[ch] == 0)) {
+				counter[ch]++;
+				counter_timer[ch] = counter_deadtime[ch];	// start deadtime
+#ifdef RATE_COUNTER_CHANNEL
+				if (ch == RATE_COUNTER_CHANNEL) {
+					rate_events++;
+				}
+#endif
+			}
+			bit <<= 1;
+		}
+	}
+#endif
 }
+#endif
 
 
 inline void ProtoCounter::updateAnalog()
 {
 #ifdef ANALOG_ENABLE
 
+	PROBE_START(PROBE_ANALOG);
+#ifdef PROTOCOUNTER_STATS
+	uint16_t stats_start = readTimer1();
+#endif
+
+#ifdef ANALOG_HIGH_RES
+	analog_raw = ICR1 - start_time;		// time of comparator event captured by timer1
+#else
 	uint16_t ana;
 	uint8_t rc;
-	uint8_t resolution;
 
 	rc = TCNT0 - start_time - 1;
-	resolution = analog_resolution;
-	if (resolution >= ANALOG_OFF) {
+	if (ANALOG_RES >= ANALOG_OFF) {
 		analog = 0;
 	}
-	else if (resolution == ANALOG_MAX_RESOLUTION) {
+	else if (ANALOG_RES == ANALOG_MAX_RESOLUTION) {
 		analog = rc;
 	}
 	else {
-		ana = rc;
-		if (resolution == ANALOG_129_DETENT_STEPS) {
-			ana += (rc >> 1);
-		}
-		else if (resolution == ANALOG_65_DETENT_STEPS) {
-			ana -= (rc >> 2);
-		}
-		else if (resolution == ANALOG_43_DETENT_STEPS) {
-			ana -= (rc >> 1);
-		}
-		else if (resolution == ANALOG_33_DETENT_STEPS) {
-			ana += rc;
-			ana += rc;
-			ana >>= 3;
-		}
-		else if (resolution == ANALOG_22_DETENT_STEPS) {
-			ana >>= 2;
-		}
+		ana = ((uint16_t)rc * analog_scale) >> 4;	// see calibrateAnalog()
 		ana += analog + 2;
 		analog = (uint8_t)(ana >> 2);
 	}
-	ACSR = (1<<ACBG) | (1<<ACI)| (0<<ACIE)| (2<<ACIS0);	// disable interrupt
-	
+#endif
+	ACSR = ANALOG_ACSR;						// disable interrupt
+
+	PROBE_STOP(PROBE_ANALOG);
+#ifdef PROTOCOUNTER_STATS
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint16_t time = TCNT1 - stats_start;
+#ifdef MUX_TIMER1
+		if (time > MUX_TOP) { time += MUX_TOP + 1; }
+#endif
+		recordTime(&stats.analog_max, &stats.analog_mean, time);
+	}
+#endif
 #endif
 }
 
@@ -579,3 +2962,66 @@ ISR(ANA_COMP_vect)
 	ProtoCounter::updateAnalog();
 }
 #endif
+
+
+#ifdef MUX_TIMER1
+ISR(TIMER1_COMPA_vect)
+// start of update cycle
+{
+	TIMSK &= ~(1<<OCIE1A);				// update() must not be nested
+	sei();								// other interrupts may interrupt update()
+	ProtoCounter::update();
+	cli();
+	TIMSK |= (1<<OCIE1A);
+}
+
+
+ISR(TIMER1_COMPB_vect)
+// end of on-time: turn display off until the next update cycle
+{
+	ANODE_PORT |= (1<<ANODE1)|(1<<ANODE2)|(1<<ANODE3);	// all anodes off
+#ifdef EXT_DIGITS
+#ifdef SWAP_PINS_PD01_FOR_PB01
+	PORTD |= 0b01111100;	// all led segments off (extra digits)
+	PORTB |= 0b00000011;
+#else
+	PORTD = 0b01111111;		// all led segments off (extra digits)
+#endif
+#endif
+	TIMSK &= ~(1<<OCIE1B);
+}
+#endif
+
+
+#ifdef SERIAL_BAUD
+ISR(USART_RX_vect)
+// byte received
+{
+	ProtoCounter::serialReceive();
+}
+
+
+ISR(USART_UDRE_vect)
+// transmit data register empty
+{
+	ProtoCounter::serialTransmit();
+}
+#endif
+
+
+#ifdef EEPROM_RECORD_SIZE
+ISR(EE_READY_vect)
+// EEPROM ready for the next byte
+{
+	ProtoCounter::eepromReady();
+}
+#endif
+
+
+#ifdef PIN_CHANGE_INT
+ISR(PCINT_PB_vect)
+// pin change interrupt of port B
+{
+	ProtoCounter::pinChange();
+}
+#endif
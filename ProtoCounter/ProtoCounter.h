@@ -34,20 +34,35 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
  * constants *
  *************/
 
+// All settings in this section are evaluated at compile time.
+// Each group can be overridden from the compiler command line
+// (e.g. -DSH_REG_IN_BITCOUNT=16 -DDIMMING=2 -DFIXED_DIMMING), so different
+// builds can use different configurations without editing this file.
+
+// size optimized profile
+// Out-comment the following line to select all options that save flash and
+// ram at the expense of run time settings: FIXED_DIMMING, FIXED_DECIMAL_PLACES,
+// FIXED_ANALOG_RESOLUTION and REDUCED_CHARSET (see below).
+// #define SMALL_FOOTPRINT
+
 // display
+#ifndef ANODE_PORT
 #define ANODE_PORT		PORTB
 #define ANODE_DDR		DDRB
 #define ANODE1			7		// display anode 1 (left digit)
 #define ANODE2			6		// display anode 2 (center digit)
 #define ANODE3			5		// display anode 3 (right digit)
+#endif
 
 // push buttons
+#ifndef BTN_PORT
 #define BTN_PORT		PORTB
 #define BTN_PIN			PINB
 #define BTN_DDR			DDRB
 #define BTN_COM			6		// bit number of common line
 #define BTN1_BIT		5		// bit number of upper push-button
 #define BTN2_BIT		7		// bit number of lower push-button
+#endif
 
 // serial interface
 // To use the hardware serial interface one needs to modify the tracks on 
@@ -58,34 +73,180 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 // Out-comment the following line if you have made such a modification.
 // #define SWAP_PINS_PD01_FOR_PB01
 
+// Interrupt driven serial telemetry and commands (requires SWAP_PINS_PD01_FOR_PB01).
+// Data is exchanged in frames (8N1, multi-byte values little endian):
+//   0xA5, type, length (0..4), payload, checksum (8 bit sum of type, length and payload)
+// Frames are sent from a ring buffer by sendFrame() without blocking. Received
+// bytes are buffered by the receive interrupt and decoded by pollCommand().
+// Do not use the Arduino "Serial" object together with this feature.
+// Out-comment the following line and set the baud rate to enable it.
+// #define SERIAL_BAUD		38400
+#ifndef SERIAL_TX_BUFFER
+#define SERIAL_TX_BUFFER	16	// size of transmit buffer (power of 2, 8..128)
+#endif
+#ifndef SERIAL_RX_BUFFER
+#define SERIAL_RX_BUFFER	8	// size of receive buffer (power of 2, 2..128)
+#endif
+
 // external shift register
+// The shift registers can be operated by the USI hardware (three-wire mode)
+// instead of bit-banging. This is considerably faster, but the USI uses
+// PB6 (DO) for data out and PB5 (DI) for data in, so the data lines of the
+// i/o extension must be swapped compared to the standard wiring.
+// Out-comment the following line if you have made such a modification.
+// #define SH_REG_USI
+#ifndef SH_REG_PORT
 #define SH_REG_PORT		PORTB	// output register
 #define SH_REG_PIN		PINB	// input register
 #define SH_REG_DDR		DDRB	// data direction register
+#ifdef SH_REG_USI
+#define SH_REG_OUT_BIT	6		// data out bit number (USI DO)
+#define SH_REG_IN_BIT	5		// data in bit number (USI DI)
+#else
 #define SH_REG_OUT_BIT	5		// data out bit number
 #define SH_REG_IN_BIT	6		// data in bit number
+#endif
 #define SH_REG_CLK_BIT	7		// clock bit number
+#endif
+#ifndef SH_REG_LD_PORT
 #define SH_REG_LD_PORT	PORTB	// shift register load signal
 #define SH_REG_LD_DDR	DDRB
 #define SH_REG_LD_BIT	0
+#endif
 
 // display
+#ifndef DIMMING
 #define DIMMING			4		// default dimming value (0 = no dimming)
 								// use dimming to reduce brightness and current consumption
+#endif
+// Extended display:
+// Additional digits can be connected to the i/o extension. Their segments
+// are wired in parallel to the segments of the on-board display and their
+// anodes (active low, like the on-board anodes) are driven by the upper
+// EXT_DIGITS bits of the output shift registers (the MSB drives the leftmost
+// digit). The extra digits are placed left of the on-board digits and are
+// multiplexed in the same frame, which lowers the brightness of all digits.
+// The shift registers are then transferred in every update cycle
+// (SH_REG_INTERVAL and SH_REG_OUT_ON_CHANGE have no effect) and the lower
+// SH_REG_OUT_BITCOUNT - EXT_DIGITS bits remain available as outputs.
+// Out-comment the following line and set the number of extra digits (1..5).
+// #define EXT_DIGITS		3
+#ifdef EXT_DIGITS
+#define MAX_DIGITS		(3 + EXT_DIGITS)	// number of digits
+#else
 #define MAX_DIGITS		3		// number of digits
-#define DECIMAL_PLACES	0		// default number of decimal places (0..2)
+#endif
+#ifndef DECIMAL_PLACES
+#define DECIMAL_PLACES	0		// default number of decimal places (0..MAX_DIGITS-1)
+#endif
+// Out-comment the following lines to make dimming and/or the number of
+// decimal places constant. setDimming() and setDecimalPlaces() then have
+// no effect, which saves ram and code in update() and writeInt().
+// #define FIXED_DIMMING
+// #define FIXED_DECIMAL_PLACES
+// Out-comment the following line to reduce the character generator to
+// hex digits, '-' and the letters used by the library (G, H, K, L, M, V).
+// All other characters are shown as blanks. Saves approx. 40 bytes flash.
+// #define REDUCED_CHARSET
+// Multiplexing by timer1:
+// By default update() is called from the timer0 compare B interrupt of
+// the sketch (approx. every 2 ms with Arduino) and dimming inserts blank
+// cycles, which lowers the refresh rate. With MUX_TIMER1 defined the library
+// runs timer1 in CTC mode and calls update() from its own interrupt at
+// MUX_FREQ update cycles per second (also in non-Arduino builds, just
+// enable interrupts with sei()). The brightness is set by the on-time of
+// each digit (timer1 compare B), so the frame rate stays constant.
+// Timer1 is not available for other purposes in this mode. The analog
+// knob needs MUX_FREQ <= 500 (ramp-up time approx. 2 ms). It measures with
+// timer0 at prescaler 1:64; in non-Arduino builds init() starts timer0 that
+// way unless it is already running.
+// Out-comment the following line to enable multiplexing by timer1.
+// #define MUX_TIMER1
+#ifndef MUX_FREQ
+#define MUX_FREQ		500		// update cycles per second (32..10000)
+#endif
+// Out-comment the following line to double buffer the display.
+// All display functions then write into a back buffer which is shown as
+// a whole at the beginning of the next multiplexing frame, so a number
+// is never displayed half-updated. Several writes can be combined into
+// one frame with beginFrame() ... commitFrame().
+// #define DISPLAY_DOUBLE_BUFFER
+// Out-comment the following line to enable scrolling text (marquee).
+// A string that is longer than the display is scrolled through it from
+// right to left by update(), see startMarquee().
+// #define MARQUEE
+#if MAX_DIGITS == 3
 #define MAX_DECIMAL		999		// largest decimal number that can be displayed
-#define MIN_DECIMAL		-99		// smallest decimal number that can be displayed
+#elif MAX_DIGITS == 4
+#define MAX_DECIMAL		9999
+#elif MAX_DIGITS == 5
+#define MAX_DECIMAL		99999
+#elif MAX_DIGITS == 6
+#define MAX_DECIMAL		999999
+#elif MAX_DIGITS == 7
+#define MAX_DECIMAL		9999999
+#else
+#define MAX_DECIMAL		99999999
+#endif
+#define MIN_DECIMAL		(-(MAX_DECIMAL / 10))	// smallest decimal number that can be displayed
+								// by writeInt(), writeLong() and writeFixed()
+								// switch to unit prefixes beyond these limits
 
 // external shift register
 // Data is shifted out with MSB first.
 // To disable the external shift register set BITCOUNT to 0
+#ifndef SH_REG_IN_BITCOUNT
 #define SH_REG_IN_BITCOUNT	8	// number of input shift register bits (range 0..32)
+#endif
+#ifndef SH_REG_OUT_BITCOUNT
 #define SH_REG_OUT_BITCOUNT	8	// number of output shift register bits (range 0..32)
+#endif
 #define SH_REG_MSB_MASK			((sr_out_data_t)1 << (SH_REG_OUT_BITCOUNT - 1))
+// Refresh rate of the shift registers:
+// Inputs and outputs are transferred every n-th update cycle.
+// With SH_REG_OUT_ON_CHANGE defined there is an additional transfer whenever
+// writeShiftRegister() changes the output data. SH_REG_INTERVAL = 0 then
+// means: transfer only on changes (readShiftRegister() is not updated).
+#ifndef SH_REG_INTERVAL
+#define SH_REG_INTERVAL		1
+#endif
+// #define SH_REG_OUT_ON_CHANGE
+// Dimmable outputs (binary code modulation):
+// Each output has a duty value (see setOutputDuty()) with SH_REG_BCM bits of
+// resolution (4..8). The duty values are stored as bit planes: bit plane k
+// holds bit k of all duty values and is shown for 2^k update cycles, so the
+// cost per update cycle is one transfer regardless of the number of outputs.
+// The shift registers are transferred in every update cycle (SH_REG_INTERVAL
+// and SH_REG_OUT_ON_CHANGE have no effect). The pwm frequency is
+// TICK_FREQ / (2^SH_REG_BCM - 1), e.g. 33 Hz with 4 bits and Arduino timing,
+// use MUX_TIMER1 with a higher MUX_FREQ for flicker-free dimming.
+// Out-comment the following line and set the resolution to enable it.
+// #define SH_REG_BCM			4
+// Debouncing of the shift register inputs:
+// An input has to be stable for 4 consecutive transfers before its debounced
+// state (see readInputs()) follows. All inputs are debounced in parallel by
+// 2 bit vertical counters (bit n of each counter word belongs to input n).
+// Changes of the debounced state are collected as rising and falling edges
+// until they are fetched by getRisingEdges() and getFallingEdges().
+// Out-comment the following line to enable debouncing.
+// #define SH_REG_DEBOUNCE
+// Pulse counters on the shift register inputs:
+// The rising edges (0 -> 1) of inputs 0..SH_REG_COUNTERS-1 are counted, after
+// debouncing if SH_REG_DEBOUNCE is defined (inputs that are high at power-up
+// are then counted once). All channels are counted in parallel by bit-sliced
+// counters (bit n of each slice belongs to input n), so an increment is a
+// short chain of word-wide XOR/AND operations. After each transfer one
+// channel is moved from the slices into its 32 bit total (round robin),
+// which keeps the slices from overflowing. getInputCount() moves the
+// channel before it is read.
+// Out-comment the following line and set the number of channels
+// (1..SH_REG_IN_BITCOUNT).
+// #define SH_REG_COUNTERS		8
 
 // analog knob
+#ifndef ANALOG_DISABLE
 #define ANALOG_ENABLE			// Enable analog knob. Out-comment to disable.
+#endif
 // The time constant of a RC combination on pin AIN1 is measured.
 // For this purpose timer0 (prescaler 1:64) is used as a timebase.
 // With the controller running at 8 MHz you can achieve a resolution of
@@ -99,12 +260,191 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #define ANALOG_33_DETENT_STEPS	5
 #define ANALOG_22_DETENT_STEPS	6
 #define ANALOG_OFF				7
+#ifndef ANALOG_RESOLUTION
+#define ANALOG_RESOLUTION		ANALOG_MAX_RESOLUTION	// default resolution
+#endif
+// Out-comment the following line to make the resolution constant.
+// setAnalogResolution() then has no effect, which saves ram and code in
+// the analog comparator interrupt routine.
+// #define FIXED_ANALOG_RESOLUTION
+// High resolution mode:
+// The ramp is timed by timer1 (16 bit, prescaler 1:8) using the input
+// capture of the analog comparator, which gives approx. 1750 steps with
+// the components above. The interrupt routine only stores the raw count.
+// getAnalog() maps it to the selected resolution using the calibration
+// values (raw count at both ends of the knob, see getAnalogRaw() and
+// setAnalogCalibration()) and a hysteresis of 1/4 step.
+// Timer1 is not available for other purposes in this mode.
+// Out-comment the following line to enable high resolution mode.
+// #define ANALOG_HIGH_RES
+#ifndef ANALOG_CAL_MIN
+#define ANALOG_CAL_MIN			0		// default calibration (raw counts)
+#define ANALOG_CAL_MAX			1750
+#endif
+
+// pulse counters
+// Falling edges on the free pins PB2..PB4 are counted by the pin change
+// interrupt, so no pulse is lost while the application is busy.
+// Channel 0 uses PB2, channel 1 PB3, channel 2 PB4. The pins are inputs
+// with pull-up. After a counted edge the channel ignores further edges for
+// its deadtime (in update cycles, 0 = no deadtime), which also debounces
+// mechanical contacts.
+// Out-comment the following line and set the number of channels (1..3).
+// #define COUNTER_CHANNELS		2
+#ifndef COUNTER_PORT
+#define COUNTER_PORT		PORTB
+#define COUNTER_PIN			PINB
+#define COUNTER_DDR			DDRB
+#define COUNTER_FIRST_BIT	2		// bit number of channel 0
+#endif
+#ifndef COUNTER_DEADTIME
+#define COUNTER_DEADTIME	0		// default deadtime (number of update cycles)
+#endif
+
+// frequency meter
+// The frequency of the signal on a free port B pin is measured by reciprocal
+// counting: the pin change interrupt time stamps the falling edges with the
+// timer0 count (8 us resolution at 8 MHz, timer0 running with prescaler
+// 1:64 as set up by Arduino). At the end of each gate time the number of
+// periods between the first and the last edge is divided by the time
+// between these edges. Fast signals are thus averaged over the gate time,
+// for slow signals the gate is extended until a full period has been seen.
+// Signals slower than the timeout read as 0 Hz.
+// The frequency meter sets OCR0A to OCR0B and uses the compare A flag, so
+// OC0A (PB2) is not available for PWM (analogWrite()).
+// Out-comment the following line to enable the frequency meter.
+// #define FREQ_METER
+#ifndef FREQ_BIT
+#define FREQ_BIT			4		// input pin (bit number of port B)
+#endif
+#ifndef FREQ_GATE_TIME
+#define FREQ_GATE_TIME		500		// gate time (number of update cycles, approx. 1 s)
+#endif
+#ifndef FREQ_TIMEOUT
+#define FREQ_TIMEOUT		5000	// maximum gate time (approx. 10 s)
+#endif
+
+// quadrature encoder
+// A rotary encoder with the outputs A and B on two free port B pins is
+// decoded by the pin change interrupt. Every change of A or B is looked up
+// in a table of the 16 possible transitions (old A, B -> new A, B), which
+// gives one quarter step forward or backward, no step, or an illegal
+// transition (both signals changed, i.e. a change has been missed).
+// Illegal transitions are counted as errors. getEncoder() returns the
+// position with 4, 2 or 1 counts per cycle of the signals (1x = one count
+// per detent for most encoders). The pins are inputs with pull-up.
+// Out-comment the following line to enable the encoder.
+// #define ENCODER
+#ifndef ENCODER_A_BIT
+#define ENCODER_A_BIT		2		// input pin of signal A (bit number of port B)
+#define ENCODER_B_BIT		3		// input pin of signal B
+#endif
+#define ENCODER_4X			0		// resolution: count every edge
+#define ENCODER_2X			1		// count every second edge
+#define ENCODER_1X			2		// count every fourth edge
+#ifndef ENCODER_RESOLUTION
+#define ENCODER_RESOLUTION	ENCODER_1X	// default resolution
+#endif
+// Out-comment the following line to show the position on the display
+// (up/down counter). Call pollEncoder() in loop(), it writes the display
+// whenever the position has changed. The interrupts only flag the change,
+// the number is formatted by the application, so the application should
+// not write to the display otherwise.
+// #define ENCODER_DISPLAY
+
+// power management
+// Out-comment the following line to enable the power saving functions:
+// - sleepIdle() stops the cpu until the next interrupt. Call it in loop()
+//   when there is nothing else to do.
+// - setDisplayTimeout() blanks the display when no button has been pressed
+//   for the given time. A button press or wakeDisplay() turns it on again.
+// - powerDown() stops the cpu, all timers and the display multiplexing
+//   until a button is pressed or an input of the pulse counters, the
+//   frequency meter or the encoder changes. Timing functions (e.g.
+//   millis()) do not advance while powered down.
+// #define POWER_MANAGER
+#ifndef DISPLAY_TIMEOUT
+#define DISPLAY_TIMEOUT		0		// default display timeout (number of update cycles, 0 = never)
+#endif
+
+// software timers
+// A pool of timers that is advanced by update(), so timed sequences (blinking,
+// output pulses, timeouts) do not need millis() polling or delay().
+// Each timer (id 0..SOFT_TIMERS-1) is either one-shot or periodic. On expiry
+// it sets a flag (see timerExpired()) and calls an optional callback
+// function. Callbacks are executed within update(), i.e. inside the timer
+// interrupt (with interrupts enabled, like the rest of update()). They must
+// be short and may only start or stop timers, set variables and switch port
+// pins. Display output, serial frames and EEPROM writes belong in loop(),
+// polled with timerExpired().
+// Out-comment the following line and set the number of timers (1..8).
+// #define SOFT_TIMERS			4
+
+// event rate
+// Events (e.g. finished parts) are collected in a ring of RATE_BINS time
+// bins of RATE_BIN_TIME update cycles each. update() keeps the number of
+// events in the last RATE_WINDOW bins up to date by adding the newest bin
+// and subtracting the one that drops out of the window, so getRate() does
+// not have to sum up the bins. The window can be changed at run time (see
+// setRateWindow()). Events are added by addRateEvents() or, with
+// RATE_COUNTER_CHANNEL defined, by every count of that pulse counter channel.
+// Out-comment the following line and set the number of bins (2..32).
+// #define RATE_BINS			12
+#ifndef RATE_BIN_TIME
+#define RATE_BIN_TIME		MS_TO_TICKS(5000)	// width of a bin (number of update cycles)
+#endif
+#ifndef RATE_WINDOW
+#define RATE_WINDOW			RATE_BINS			// default window (number of bins)
+#endif
+// Out-comment the following line to count the events of a pulse counter
+// channel (see COUNTER_CHANNELS).
+// #define RATE_COUNTER_CHANNEL	0
+
+// EEPROM persistence
+// saveRecord() stores a record of EEPROM_RECORD_SIZE bytes (e.g. a struct
+// with counter and settings) without blocking: the bytes are written by
+// the EEPROM ready interrupt. Records are written into consecutive slots of
+// a ring, each slot holding sequence number, record and checksum, so every
+// slot is only written once per round through the ring (wear leveling).
+// loadRecord() recovers the latest complete record at startup.
+// Out-comment the following line and set the record size (1..32 bytes).
+// #define EEPROM_RECORD_SIZE	4
+#ifndef EEPROM_RING_START
+#define EEPROM_RING_START	0		// first EEPROM address used by the ring
+#define EEPROM_RING_END		E2END	// last EEPROM address used by the ring
+#endif
+
+// interrupt instrumentation
+// Out-comment the following line to measure the duration of every update()
+// and analog comparator interrupt with timer1 (prescaler 1:8, i.e. 1 us at
+// 8 MHz). getStats() returns maximum and mean durations and the number of
+// overruns (update() took longer than an update cycle) and of nested calls
+// of update(). Timer1 then runs in normal mode (unless it is already used by
+// MUX_TIMER1 or ANALOG_HIGH_RES) and is not available to the application.
+// #define PROTOCOUNTER_STATS
+// Out-comment the following line to set a pin of port B high while update()
+// is running (e.g. for a logic analyzer). It must be one of PB2..PB4 that is
+// not used by the pulse counters, the frequency meter or the encoder, e.g.
+// PB2 next to the frequency meter on its default pin PB4.
+// #define STATS_DEBUG_BIT		2
 
 // push buttons
 // For Arduino: When ProtoCounter runs at 8 MHz the update cycle is approx. 2 ms.
+#ifndef BTN_SAMPLE_INTERVAL
 #define BTN_SAMPLE_INTERVAL	10		// buttons are sampled every n-th update cycle
+#endif
+#ifndef BTN_LONGPRESS_DELAY
 #define BTN_LONGPRESS_DELAY	50		// time (as number of sample intervals)
 									// after which a longpress event is generated
+#endif
+
+// Out-comment the following line to store button events in a queue.
+// Events are then not lost while the application is busy (e.g. in delay()).
+// They are fetched with popButtonEvent(), each with the tick count
+// (see getTicks()) of its occurrence. The value is the queue size and must
+// be a power of 2. The queue holds up to size-1 events, further events
+// are dropped. getButton() and buttonAck() keep working as before.
+// #define BTN_EVENT_QUEUE		8
 
 // bit masks for push buttons (do not change)
 #define BUTTON1				(1<<BTN1_BIT)
@@ -127,6 +467,79 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #define BOTH_PRESSED		(BOTH_BTNS | PB_PRESS)
 #define BOTH_RELEASED		(BOTH_BTNS | PB_RELEASE)
 #define BOTH_LONGPRESSED	(BOTH_BTNS | PB_LONGPRESS)
+#define BTN1_LONGRELEASED	(BUTTON1 | PB_LONG)		// release after an acknowledged longpress
+#define BTN2_LONGRELEASED	(BUTTON2 | PB_LONG)
+#define BOTH_LONGRELEASED	(BOTH_BTNS | PB_LONG)
+
+// serial frame types
+#define SERIAL_FRAME_START	0xA5	// first byte of a frame
+#define SERIAL_MAX_PAYLOAD	4		// maximum payload length
+#define MSG_COUNTER			0x10	// counter value (0x10 + channel), int32
+#define MSG_BUTTON			0x20	// button event (see getButton())
+#define MSG_SH_REG_IN		0x21	// shift register inputs
+#define MSG_VALUE			0x22	// application value, int32
+// commands handled by pollCommand()
+#define CMD_WRITE_LONG		0x80	// display a number (int8..int32, see writeLong())
+#define CMD_SET_DISPLAY		0x81	// led patterns, payload[0] = rightmost digit
+#define CMD_WRITE_SH_REG	0x82	// set shift register outputs (zero extended)
+// All other frame types (e.g. for setting limits) are passed to the application.
+
+// options selected by the size optimized profile (do not change)
+#ifdef SMALL_FOOTPRINT
+#ifndef FIXED_DIMMING
+#define FIXED_DIMMING
+#endif
+#ifndef FIXED_DECIMAL_PLACES
+#define FIXED_DECIMAL_PLACES
+#endif
+#ifndef FIXED_ANALOG_RESOLUTION
+#define FIXED_ANALOG_RESOLUTION
+#endif
+#ifndef REDUCED_CHARSET
+#define REDUCED_CHARSET
+#endif
+#endif
+
+// pin change interrupt of port B, shared by several features (do not change)
+#if defined(COUNTER_CHANNELS) || defined(FREQ_METER) || defined(ENCODER) || defined(POWER_MANAGER)
+#define PIN_CHANGE_INT
+#endif
+
+// number of update cycles per second (do not change)
+#ifdef MUX_TIMER1
+#define TICK_FREQ			MUX_FREQ
+#else
+#define TICK_FREQ			(F_CPU / 64 / 256)	// timer0 compare B (Arduino)
+#endif
+
+// convert a time in milliseconds to update cycles (do not change)
+#define MS_TO_TICKS(ms)		((uint16_t)(((uint32_t)(ms) * TICK_FREQ + 500) / 1000))
+
+// update cycle counter (do not change)
+// It is incremented by every call of update() and is needed by several features.
+#if defined(BTN_EVENT_QUEUE) || defined(FREQ_METER)
+#define TICK_COUNTER
+#endif
+
+// number of bit slices of the shift register input counters (do not change)
+// Each channel is moved into its total every SH_REG_COUNTERS transfers, so
+// the slices must hold up to SH_REG_COUNTERS edges.
+#ifdef SH_REG_COUNTERS
+#if SH_REG_COUNTERS < 4
+#define COUNT_SLICES		2
+#elif SH_REG_COUNTERS < 8
+#define COUNT_SLICES		3
+#elif SH_REG_COUNTERS < 16
+#define COUNT_SLICES		4
+#elif SH_REG_COUNTERS < 32
+#define COUNT_SLICES		5
+#else
+#define COUNT_SLICES		6
+#endif
+#endif
+
+// number of slots of the software timer wheel (power of 2, do not change)
+#define TIMER_WHEEL_SLOTS	4
 
 
 /**************
@@ -154,6 +567,18 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #endif
 
 
+#ifdef PROTOCOUNTER_STATS
+struct isr_stats_t {
+	uint16_t	update_max;		// longest update() (in timer1 counts, F_CPU/8)
+	uint16_t	update_mean;	// mean duration of update() (exponential average)
+	uint16_t	analog_max;		// longest analog comparator interrupt
+	uint16_t	analog_mean;	// mean duration of analog comparator interrupt
+	uint16_t	overruns;		// update() took longer than an update cycle
+	uint16_t	reentries;		// update() was called while it was still running
+};
+#endif
+
+
 /********************
  * class definition *
  ********************/
@@ -165,33 +590,299 @@ public:
 	static void clearDisplay();
 	static uint8_t getDisplay(uint8_t pos);
 	static void setDisplay(uint8_t led_pattern, uint8_t pos);
+	static uint8_t charToPattern(uint8_t ascii_code);
 	static void writeChar(uint8_t ascii_code, uint8_t pos);
 	static void writeString_P(const char* st);
+#ifdef MARQUEE
+	static void startMarquee(const char* st, uint16_t speed, void (*callback)(void) = 0);
+	static void startMarquee_P(const char* st, uint16_t speed, void (*callback)(void) = 0);
+	static void stopMarquee();
+	static uint8_t isMarqueeRunning();
+#endif
 	static void writeInt(int16_t val);
+	static void writeLong(int32_t val);
+	static void writeFixed(int32_t val, uint8_t decimals);
 	static void writeHex(uint8_t val);
+#ifdef DISPLAY_DOUBLE_BUFFER
+	static void beginFrame();
+	static void commitFrame();
+#else
+	static void beginFrame() {}
+	static void commitFrame() {}
+#endif
+#ifdef FIXED_DIMMING
+	static void	setDimming(uint8_t) {}
+#else
 	static void	setDimming(uint8_t dim);
+#endif
+#ifdef MUX_TIMER1
+	static void	setBrightness(uint8_t brightness);
+#endif
+#ifdef FIXED_DECIMAL_PLACES
+	static void	setDecimalPlaces(uint8_t) {}
+#else
 	static void	setDecimalPlaces(uint8_t decimals);
+#endif
+#ifdef FIXED_ANALOG_RESOLUTION
+	static void	setAnalogResolution(uint8_t) {}
+#else
 	static void	setAnalogResolution(uint8_t ana_res);
+#endif
+#ifdef POWER_MANAGER
+	static void sleepIdle();
+	static void powerDown();
+	static void setDisplayTimeout(uint16_t timeout);
+	static void wakeDisplay();
+	static uint8_t isDisplayOn();
+#endif
 	static uint8_t getButton();
 	static void buttonAck();
+#ifdef BTN_EVENT_QUEUE
+	static uint8_t popButtonEvent(uint16_t* time = 0);
+#endif
+#ifdef TICK_COUNTER
+	static uint16_t getTicks();
+#endif
+#ifdef SOFT_TIMERS
+	static void startTimer(uint8_t id, uint16_t delay, uint16_t period = 0, void (*callback)(void) = 0);
+	static void stopTimer(uint8_t id);
+	static uint8_t timerRunning(uint8_t id);
+	static uint8_t timerExpired(uint8_t id);
+#endif
+#ifdef RATE_BINS
+	static void addRateEvents(uint16_t n = 1);
+	static void setRateWindow(uint8_t bins);
+	static uint32_t getRate(uint16_t seconds = 60);
+	static void writeRate(uint16_t seconds = 60);
+#endif
+#ifdef SERIAL_BAUD
+	static uint8_t sendFrame(uint8_t type, const void* payload, uint8_t len);
+	static uint8_t pollCommand(uint8_t* payload, uint8_t* len = 0);
+	static inline void serialReceive();
+	static inline void serialTransmit();
+#endif
+#ifdef EEPROM_RECORD_SIZE
+	static uint8_t loadRecord(void* record);
+	static uint8_t saveRecord(const void* record);
+	static uint8_t isSaving();
+	static inline void eepromReady();
+#endif
+#ifdef PROTOCOUNTER_STATS
+	static void getStats(isr_stats_t* stats);
+	static void resetStats();
+#endif
 	static sr_in_data_t readShiftRegister();
 	static void writeShiftRegister(sr_out_data_t out_data);
+#ifdef SH_REG_BCM
+	static void setOutputDuty(uint8_t ch, uint8_t duty);
+	static void setOutputDuties(const uint8_t* duty);
+#endif
+#ifdef SH_REG_DEBOUNCE
+	static sr_in_data_t readInputs();
+	static sr_in_data_t getRisingEdges(sr_in_data_t mask = (sr_in_data_t)~0);
+	static sr_in_data_t getFallingEdges(sr_in_data_t mask = (sr_in_data_t)~0);
+#endif
+#ifdef SH_REG_COUNTERS
+	static uint32_t getInputCount(uint8_t ch);
+	static uint32_t resetInputCount(uint8_t ch);
+#endif
 	static uint8_t getAnalog();
+#ifdef ANALOG_HIGH_RES
+	static uint16_t getAnalogRaw();
+	static void setAnalogCalibration(uint16_t raw_min, uint16_t raw_max);
+#endif
+#ifdef COUNTER_CHANNELS
+	static int32_t getCounter(uint8_t ch);
+	static int32_t resetCounter(uint8_t ch);
+	static void addCounter(uint8_t ch, int32_t val);
+	static void setCounterDeadtime(uint8_t ch, uint8_t deadtime);
+#endif
+#ifdef FREQ_METER
+	static uint32_t getFrequency();
+	static uint32_t getPeriod();
+	static void writeFrequency();
+#endif
+#ifdef ENCODER
+	static int32_t getEncoder();
+	static int32_t resetEncoder();
+	static uint16_t getEncoderErrors();
+	static void setEncoderResolution(uint8_t res);
+	static void writeEncoder();
+#ifdef ENCODER_DISPLAY
+	static uint8_t pollEncoder();
+#endif
+#endif
 	static void	update();
 	static inline void updateAnalog();
+#ifdef PIN_CHANGE_INT
+	static inline void pinChange();
+#endif
 
 private:
+#if !defined(FIXED_DIMMING) && !defined(MUX_TIMER1)
 	static uint8_t dimming;
+#endif
+#ifdef MUX_TIMER1
+	static uint16_t mux_on_time;			// on-time of a digit (timer1 counts)
+#endif
+#ifndef FIXED_DECIMAL_PLACES
 	static uint8_t decimal_places;
+#endif
+#ifndef FIXED_ANALOG_RESOLUTION
 	static uint8_t analog_resolution;
+#endif
+#ifdef DISPLAY_DOUBLE_BUFFER
+	static uint8_t display[2][MAX_DIGITS];	// front and back buffer
+	static uint8_t* volatile front;			// buffer shown by update()
+	static uint8_t* volatile back;			// buffer written by display functions
+	static volatile uint8_t frame_pending;	// back buffer is to be shown
+	static uint8_t frame_depth;				// nesting level of beginFrame()
+#else
 	static uint8_t display[MAX_DIGITS];		// display[0] = rightmost digit
+#endif
+#ifdef SERIAL_BAUD
+	static uint8_t tx_buffer[SERIAL_TX_BUFFER];		// transmit ring buffer
+	static volatile uint8_t tx_head;		// written by the application only
+	static volatile uint8_t tx_tail;		// written by the isr only
+	static uint8_t rx_buffer[SERIAL_RX_BUFFER];		// receive ring buffer
+	static volatile uint8_t rx_head;		// written by the isr only
+	static volatile uint8_t rx_tail;		// written by the application only
+	static uint8_t rx_state;				// frame decoder: next byte expected
+	static uint8_t rx_type;					// frame being received
+	static uint8_t rx_len;					// payload length
+	static uint8_t rx_pos;					// payload bytes received
+	static uint8_t rx_sum;					// running checksum
+	static uint8_t rx_payload[SERIAL_MAX_PAYLOAD];
+#endif
+#ifdef EEPROM_RECORD_SIZE
+	static uint8_t ee_buffer[EEPROM_RECORD_SIZE + 2];	// slot being written
+	static volatile uint8_t ee_pos;			// next byte of the slot to write
+	static uint8_t ee_addr;					// address of the slot being written
+	static uint8_t ee_next;					// address of the next free slot
+	static uint8_t ee_seq;					// sequence number of the latest record
+#endif
+#ifdef MARQUEE
+	static const char* marquee_text;		// next character to scroll in
+	static uint8_t marquee_flash;			// text is stored in flash memory
+	static uint8_t marquee_tail;			// blanks left to scroll out the text
+	static uint16_t marquee_speed;			// update cycles per step
+	static volatile uint16_t marquee_timer;	// 0 = marquee stopped
+	static uint8_t marquee_due;				// next step is due
+	static void (*marquee_callback)(void);	// called when the text has passed
+	static void startMarquee(const char* st, uint8_t flash, uint16_t speed, void (*callback)(void));
+	static inline void scrollMarquee();
+#endif
 	static uint8_t button;					// button event
+#ifdef POWER_MANAGER
+	static uint16_t display_timeout;		// display timeout (0 = never)
+	static volatile uint16_t idle_timer;	// time since last button activity
+#endif
 	static uint8_t pb_timer;				// push button timer
 	static uint8_t pb_delay_timer;			// push button delay timer
+#ifdef BTN_EVENT_QUEUE
+	static volatile uint8_t btn_queue_event[BTN_EVENT_QUEUE];	// event queue
+	static volatile uint16_t btn_queue_time[BTN_EVENT_QUEUE];	// tick count of each event
+	static volatile uint8_t btn_queue_head;	// written by the isr only
+	static volatile uint8_t btn_queue_tail;	// written by the application only
+#endif
+#ifdef TICK_COUNTER
+	static volatile uint16_t ticks;			// number of update() calls
+#endif
+#ifdef SOFT_TIMERS
+	static uint16_t timer_rounds[SOFT_TIMERS];	// remaining revolutions of the wheel
+	static uint16_t timer_period[SOFT_TIMERS];	// reload value (0 = one-shot)
+	static uint8_t timer_slot[SOFT_TIMERS];		// slot of the wheel
+	static uint8_t wheel_slot[TIMER_WHEEL_SLOTS];	// bit n = timer n is in this slot
+	static void (*timer_callback[SOFT_TIMERS])(void);
+	static volatile uint8_t timer_running;		// bit n = timer n is running
+	static volatile uint8_t timer_expired;		// bit n = timer n has expired
+	static uint8_t wheel_pos;					// current slot of the wheel
+	static void scheduleTimer(uint8_t id, uint16_t delay);
+	static inline void updateTimers();
+#endif
+#ifdef RATE_BINS
+	static uint16_t rate_bin[RATE_BINS];		// events per completed bin
+	static volatile uint16_t rate_events;		// events of the current bin
+	static volatile uint32_t rate_sum;			// events in the window
+	static uint16_t rate_timer;					// remaining update cycles of the current bin
+	static uint8_t rate_pos;					// next bin to be completed
+	static uint8_t rate_window;					// window length (number of bins)
+	static uint8_t rate_filled;					// number of completed bins (up to RATE_BINS)
+	static inline void updateRate();
+#endif
+#ifdef PROTOCOUNTER_STATS
+	static isr_stats_t stats;				// means are kept as 8 times the value
+	static uint8_t stats_depth;				// nesting level of update()
+	static inline uint16_t readTimer1();
+	static void recordTime(uint16_t* max, uint16_t* mean, uint16_t time);
+#endif
 	static volatile sr_in_data_t  sh_reg_in_data;	// data read from shift registers
 	static volatile sr_out_data_t sh_reg_out_data;	// data to be written to shift registers
+#ifdef SH_REG_OUT_ON_CHANGE
+	static volatile uint8_t sh_reg_dirty;		// output data has changed
+#endif
+#ifdef SH_REG_BCM
+	static sr_out_data_t bcm_plane[SH_REG_BCM];	// bit planes of the duty values
+	static uint8_t bcm_slot;					// bit plane being shown
+	static uint8_t bcm_timer;					// remaining update cycles of the slot
+#endif
+#ifdef SH_REG_DEBOUNCE
+	static sr_in_data_t debounce_cnt0;			// vertical counter, bit 0
+	static sr_in_data_t debounce_cnt1;			// vertical counter, bit 1
+	static volatile sr_in_data_t input_state;	// debounced inputs
+	static volatile sr_in_data_t input_rising;	// edges not yet fetched
+	static volatile sr_in_data_t input_falling;
+	static inline sr_in_data_t debounceInputs();
+#endif
+#ifdef SH_REG_COUNTERS
+	static sr_in_data_t count_slice[COUNT_SLICES];	// bit-sliced counters (slice 0 = LSB)
+	static uint32_t count_total[SH_REG_COUNTERS];	// counts moved out of the slices
+	static uint8_t count_flush;					// channel to be moved next
+	static sr_in_data_t count_flush_mask;		// its bit in the slices
+#ifndef SH_REG_DEBOUNCE
+	static sr_in_data_t count_last;				// inputs of the previous transfer
+#endif
+	static inline void countInputs(sr_in_data_t edges);
+	static void flushCount(uint8_t ch, sr_in_data_t mask);
+#endif
+#ifdef PIN_CHANGE_INT
+	static uint8_t pin_level;				// last level of port B pins
+#endif
+#ifdef COUNTER_CHANNELS
+	static volatile int32_t counter[COUNTER_CHANNELS];		// pulse counts
+	static uint8_t counter_deadtime[COUNTER_CHANNELS];		// deadtime per channel
+	static volatile uint8_t counter_timer[COUNTER_CHANNELS];	// remaining deadtime
+#endif
+#ifdef FREQ_METER
+	static volatile uint16_t freq_edges;	// number of edges in current gate
+	static volatile uint32_t freq_first;	// time stamp of first edge
+	static volatile uint32_t freq_last;		// time stamp of last edge
+	static uint16_t freq_timer;				// gate timer
+	static volatile uint16_t freq_periods;	// result: number of periods ...
+	static volatile uint32_t freq_time;		// ... and their duration (timer0 counts)
+	static inline uint32_t timeStamp();
+#endif
+#ifdef ENCODER
+	static volatile int32_t encoder_steps;	// position in quarter steps
+	static volatile uint16_t encoder_errors;	// number of illegal transitions
+	static uint8_t encoder_state;			// last level of A and B (A = bit 1)
+	static uint8_t encoder_resolution;
+#ifdef ENCODER_DISPLAY
+	static volatile uint8_t encoder_changed;	// position has to be displayed
+#endif
+#endif
 	static volatile uint8_t analog;			// stores the last analog value
+#ifdef ANALOG_HIGH_RES
+	static volatile uint16_t start_time;	// start time of analog ramp-up
+	static volatile uint16_t analog_raw;	// duration of last analog ramp-up
+	static uint16_t analog_min;				// calibration values
+	static uint16_t analog_max;
+	static uint16_t analog_scale;			// 1/16 steps per raw count (8.8 fixed point)
+#else
 	static volatile uint8_t start_time;		// start time of analog ramp-up
+	static volatile uint8_t analog_scale;	// factor for the ramp-up time (1/16)
+#endif
+	static void calibrateAnalog();
 	static void updateShiftRegister();
 	static void sampleButtons();
 };
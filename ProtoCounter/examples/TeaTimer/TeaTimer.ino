@@ -67,6 +67,10 @@ int value;
  * functions *
  *************/
 
+void show_time(byte m, byte s);
+void leave_running();
+void leave_alarm();
+
 void reset_timer()
 {
   if (mode == RUNNING) {
@@ -0,0 +1,37 @@
+/*
+ * probes.h
+ *
+ * Probe definitions for the cycle benchmark.
+ * This file is force-included (gcc option -include) into every translation
+ * unit of the benchmark build. Timer1 runs at the cpu clock, a probe stores
+ * the timer value at the start and at the end of a code section. The
+ * benchmark evaluates the time stamps after each call of update() and
+ * after each of the number formatting calls.
+ *
+ * Probes may be nested (e.g. PROBE_BUTTONS inside PROBE_UPDATE). The inner
+ * probe adds a few cycles (two timer reads and stores) to the outer one.
+ */
+
+#ifndef PROBES_H_
+#define PROBES_H_
+
+#include <inttypes.h>
+#include <avr/io.h>
+
+#define PROBE_UPDATE	0		// ProtoCounter::update()
+#define PROBE_BUTTONS	1		// ProtoCounter::sampleButtons()
+#define PROBE_ANALOG	2		// ProtoCounter::updateAnalog()
+#define PROBE_SH_REG	3		// ProtoCounter::updateShiftRegister()
+#define PROBE_WRITE_INT	4		// ProtoCounter::writeInt(), values -99..999
+#define PROBE_WRITE_LONG	5	// ProtoCounter::writeLong(), same values
+#define PROBE_WRITE_L32	6		// ProtoCounter::writeLong(), full 32 bit range
+#define PROBE_COUNT		7
+
+extern volatile uint16_t	probe_start[PROBE_COUNT];
+extern volatile uint16_t	probe_stop[PROBE_COUNT];
+extern volatile uint8_t		probe_hit;		// bit n = probe n has been passed
+
+#define PROBE_START(id)		do { probe_start[id] = TCNT1; } while (0)
+#define PROBE_STOP(id)		do { probe_stop[id] = TCNT1; probe_hit |= (1 << (id)); } while (0)
+
+#endif /* PROBES_H_ */
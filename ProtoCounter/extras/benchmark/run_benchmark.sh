@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# run_benchmark.sh
+#
+# Builds the cycle benchmark (update_benchmark.cpp) for a matrix of
+# library configurations and runs each build in simavr.
+#
+# requirements: avr-gcc, simavr (with its header avr_mcu_section.h)
+#
+# environment:
+#   MCU             target controller          (default attiny4313)
+#   SIMAVR_INCLUDE  path of avr_mcu_section.h  (default /usr/include/simavr/avr)
+#   BITCOUNTS       shift register widths      (default "0 8 16 32")
+#   TRANSFERS       shift register transfer    (default "bitbang usi")
+#   EXTRA_CONFIGS   additional -D flags, one configuration per entry,
+#                   entries separated by ';'   (default: none)
+#   BENCH_CALLS     number of update() calls   (default 1000)
+
+MCU=${MCU:-attiny4313}
+SIMAVR_INCLUDE=${SIMAVR_INCLUDE:-/usr/include/simavr/avr}
+BITCOUNTS=${BITCOUNTS:-"0 8 16 32"}
+TRANSFERS=${TRANSFERS:-"bitbang usi"}
+BENCH_CALLS=${BENCH_CALLS:-1000}
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB="$HERE/../.."
+BUILD=${BUILD:-"$HERE/build"}
+mkdir -p "$BUILD" || exit 1
+
+CFLAGS="-mmcu=$MCU -DF_CPU=8000000UL -Os -Wall -ffunction-sections -fdata-sections \
+ -Wl,--gc-sections -DBENCH_MCU=\"$MCU\" -DBENCH_CALLS=$BENCH_CALLS \
+ -I$LIB -I$HERE -I$SIMAVR_INCLUDE -include $HERE/probes.h"
+
+run()
+# run(name, flags...)
+{
+	name=$1
+	shift
+	elf="$BUILD/$name.elf"
+	avr-g++ $CFLAGS "$@" -o "$elf" "$HERE/update_benchmark.cpp" "$LIB/ProtoCounter.cpp" || return 1
+	simavr "$elf" 2>/dev/null | grep -v "^Loaded\|^SIMAVR"
+	echo
+}
+
+for transfer in $TRANSFERS; do
+	usi=""
+	[ "$transfer" = "usi" ] && usi="-DSH_REG_USI"
+	for analog in "" "-DANALOG_DISABLE"; do
+		for swap in "" "-DSWAP_PINS_PD01_FOR_PB01"; do
+			for in_bits in $BITCOUNTS; do
+				for out_bits in $BITCOUNTS; do
+					run "${transfer}_in${in_bits}_out${out_bits}${analog:+_noanalog}${swap:+_swap}" \
+						-DSH_REG_IN_BITCOUNT=$in_bits -DSH_REG_OUT_BITCOUNT=$out_bits \
+						$usi $analog $swap || exit 1
+				done
+			done
+		done
+	done
+done
+
+# additional configurations
+n=0
+echo "$EXTRA_CONFIGS" | tr ';' '\n' | while read -r flags; do
+	[ -z "$flags" ] && continue
+	n=$((n + 1))
+	echo "extra configuration: $flags"
+	run "extra$n" $flags || exit 1
+done
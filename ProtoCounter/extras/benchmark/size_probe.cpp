@@ -0,0 +1,91 @@
+/*
+ * size_probe.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Minimal application for the flash/ram size report
+					- sets up timer0 like the Arduino core and calls update()
+					  from the timer0 compare B interrupt
+					- uses the functions of a typical application (buttons,
+					  number output, analog knob, shift registers), so the
+					  size reflects the library as it is used
+
+					Built for a matrix of configurations by "size_report.sh".
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+/************
+ * includes *
+ ************/
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "ProtoCounter.h"
+
+
+/**********************
+ * interrupt routines *
+ **********************/
+
+ISR(TIMER0_COMPB_vect)
+{
+	sei();
+	ProtoCounter::update();
+}
+
+
+/********
+ * main *
+ ********/
+
+int main()
+{
+	int16_t value = 0;
+	uint8_t event;
+
+	TCCR0A = (1<<WGM01)|(1<<WGM00);		// fast pwm
+	TCCR0B = (1<<CS01)|(1<<CS00);		// prescaler 1:64
+	OCR0B = 125;
+	TIMSK |= (1<<OCIE0B);
+	ProtoCounter::init();
+	sei();
+
+	while (1) {
+		event = ProtoCounter::getButton();
+		if (event == BTN1_PRESSED) {
+			value++;
+		}
+		else if (event == BTN2_PRESSED) {
+			value = ProtoCounter::getAnalog();
+		}
+		else if (event == BTN1_LONGPRESSED) {
+			ProtoCounter::writeHex((uint8_t)ProtoCounter::readShiftRegister());
+			ProtoCounter::buttonAck();
+			continue;
+		}
+		if (event) {
+			ProtoCounter::buttonAck();
+			ProtoCounter::writeShiftRegister(value);
+			ProtoCounter::writeInt(value);
+		}
+	}
+	return (0);
+}
@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# size_report.sh
+#
+# Builds a minimal application (size_probe.cpp) for a matrix of library
+# configurations and prints the size of the .text, .data and .bss sections
+# of each build, so changes of the flash and ram footprint show up as
+# numbers. Flash usage is text + data, ram usage (without stack) is
+# data + bss.
+#
+# requirements: avr-gcc, avr-size
+#
+# environment:
+#   MCU             target controller          (default attiny2313)
+#   BITCOUNTS       shift register widths      (default "0 8 16 32")
+#   PROFILES        library options, one profile per entry, entries
+#                   separated by ';'           (default: standard and
+#                                               SMALL_FOOTPRINT)
+#   EXTRA_CONFIGS   additional -D flags, one configuration per entry,
+#                   entries separated by ';'   (default: none)
+
+MCU=${MCU:-attiny2313}
+BITCOUNTS=${BITCOUNTS:-"0 8 16 32"}
+PROFILES=${PROFILES:-" ;-DSMALL_FOOTPRINT"}
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB="$HERE/../.."
+BUILD=${BUILD:-"$HERE/build"}
+mkdir -p "$BUILD" || exit 1
+
+CFLAGS="-mmcu=$MCU -DF_CPU=8000000UL -Os -Wall -ffunction-sections -fdata-sections \
+ -Wl,--gc-sections -I$LIB"
+
+size()
+# size(name, flags...)
+{
+	name=$1
+	shift
+	elf="$BUILD/size_$name.elf"
+	avr-g++ $CFLAGS "$@" -o "$elf" "$HERE/size_probe.cpp" "$LIB/ProtoCounter.cpp" || return 1
+	avr-size -A "$elf" | awk -v name="$name" '
+		$1 == ".text"	{ text = $2 }
+		$1 == ".data"	{ data = $2 }
+		$1 == ".bss"	{ bss = $2 }
+		END				{ printf("%-40s %6d %6d %6d %6d %6d\n", name, text, data, bss, text + data, data + bss) }'
+}
+
+printf "%-40s %6s %6s %6s %6s %6s\n" "configuration ($MCU)" "text" "data" "bss" "flash" "ram"
+
+echo "$PROFILES" | tr ';' '\n' | while read -r profile; do
+	for analog in "" "-DANALOG_DISABLE"; do
+		for swap in "" "-DSWAP_PINS_PD01_FOR_PB01"; do
+			for bits in $BITCOUNTS; do
+				name="in${bits}_out${bits}${analog:+_noanalog}${swap:+_swap}"
+				[ -n "$profile" ] && name="${name}_$(echo "$profile" | sed 's/^-D//; s/ -D/_/g' | tr 'A-Z' 'a-z')"
+				size "$name" -DSH_REG_IN_BITCOUNT=$bits -DSH_REG_OUT_BITCOUNT=$bits \
+					$analog $swap $profile || exit 1
+			done
+		done
+	done
+done
+
+# additional configurations
+n=0
+echo "$EXTRA_CONFIGS" | tr ';' '\n' | while read -r flags; do
+	[ -z "$flags" ] && continue
+	n=$((n + 1))
+	echo "extra configuration $n: $flags"
+	size "extra$n" $flags || exit 1
+done
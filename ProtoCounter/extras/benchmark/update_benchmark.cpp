@@ -0,0 +1,254 @@
+/*
+ * update_benchmark.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Cycle benchmark for the ProtoCounter interrupt routines
+					- calls update() a fixed number of times
+					- calls the analog comparator routine whenever update() has
+					  started an analog measurement
+					- reports best/worst/mean cycles of update(), sampleButtons(),
+					  updateAnalog() and updateShiftRegister()
+					- compares writeInt() with writeLong() for the same values
+					  and measures writeLong() over the full 32 bit range
+
+					Intended to be run in simavr (see "run_benchmark.sh"). The
+					report is written to the simavr console (register GPIOR0).
+					In a host build (PROTOCOUNTER_HOST) it is written to stdout.
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+/************
+ * includes *
+ ************/
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include "ProtoCounter.h"
+#include "probes.h"
+
+#ifdef PROTOCOUNTER_HOST
+	#include <stdio.h>
+#else
+	#include <avr/sleep.h>
+	#include "avr_mcu_section.h"
+	AVR_MCU(F_CPU, BENCH_MCU);
+	AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+#endif
+
+
+/*************
+ * constants *
+ *************/
+
+#ifndef BENCH_CALLS
+#define BENCH_CALLS		1000		// number of update() calls
+#endif
+
+
+/**************
+ * data types *
+ **************/
+
+struct stats_t {
+	uint16_t	min;
+	uint16_t	max;
+	uint32_t	sum;
+	uint16_t	count;
+};
+
+
+/********************
+ * global variables *
+ ********************/
+
+volatile uint16_t	probe_start[PROBE_COUNT];
+volatile uint16_t	probe_stop[PROBE_COUNT];
+volatile uint8_t	probe_hit;
+
+static stats_t		stats[PROBE_COUNT];
+static uint16_t		overhead;			// cycles of an empty probe
+
+static const char	probe_name[PROBE_COUNT][12] PROGMEM =
+						{"update", "buttons", "analog", "sh_reg",
+						 "writeInt", "writeLong", "writeLong32"};
+
+#ifdef ANALOG_ENABLE
+extern "C" void ANA_COMP_vect(void);	// analog comparator interrupt routine
+#endif
+
+
+/*************
+ * functions *
+ *************/
+
+static void put_char(char ch)
+{
+#ifdef PROTOCOUNTER_HOST
+	putchar(ch);
+#else
+	GPIOR0 = ch;
+#endif
+}
+
+
+static void put_string_P(const char* st)
+{
+	char ch;
+
+	while ((ch = pgm_read_byte(st))) {
+		put_char(ch);
+		st++;
+	}
+}
+
+
+static void put_uint(uint32_t val)
+{
+	char	digit[10];
+	uint8_t	i = 0;
+
+	do {
+		digit[i++] = '0' + (val % 10);
+		val /= 10;
+	} while (val);
+	while (i) {
+		put_char(digit[--i]);
+	}
+}
+
+
+static void collect()
+// add the time stamps of all probes that have been passed to the statistics
+{
+	uint8_t		id;
+	uint16_t	cycles;
+	stats_t*	s;
+
+	for (id = 0; id < PROBE_COUNT; id++) {
+		if (probe_hit & (1 << id)) {
+			cycles = probe_stop[id] - probe_start[id] - overhead;
+			s = &stats[id];
+			if ((s->count == 0) || (cycles < s->min)) { s->min = cycles; }
+			if (cycles > s->max) { s->max = cycles; }
+			s->sum += cycles;
+			s->count++;
+		}
+	}
+	probe_hit = 0;
+}
+
+
+static void report()
+{
+	uint8_t		id;
+	stats_t*	s;
+
+	put_string_P(PSTR("config in="));
+	put_uint(SH_REG_IN_BITCOUNT);
+	put_string_P(PSTR(" out="));
+	put_uint(SH_REG_OUT_BITCOUNT);
+#ifdef ANALOG_ENABLE
+	put_string_P(PSTR(" analog=1"));
+#else
+	put_string_P(PSTR(" analog=0"));
+#endif
+#ifdef SWAP_PINS_PD01_FOR_PB01
+	put_string_P(PSTR(" swap=1"));
+#else
+	put_string_P(PSTR(" swap=0"));
+#endif
+#ifdef SH_REG_USI
+	put_string_P(PSTR(" transfer=usi\n"));
+#else
+	put_string_P(PSTR(" transfer=bitbang\n"));
+#endif
+
+	for (id = 0; id < PROBE_COUNT; id++) {
+		s = &stats[id];
+		if (s->count == 0) { continue; }
+		put_string_P(probe_name[id]);
+		put_string_P(PSTR(" calls="));
+		put_uint(s->count);
+		put_string_P(PSTR(" best="));
+		put_uint(s->min);
+		put_string_P(PSTR(" worst="));
+		put_uint(s->max);
+		put_string_P(PSTR(" mean="));
+		put_uint((s->sum + s->count / 2) / s->count);
+		put_char('\n');
+	}
+}
+
+
+/********
+ * main *
+ ********/
+
+int main()
+{
+	uint16_t n;
+
+	ProtoCounter::init();
+	TCCR1A = 0;
+	TCCR1B = (1<<CS10);					// timer1 counts cpu cycles
+
+	PROBE_START(0);						// calibrate
+	PROBE_STOP(0);
+	overhead = probe_stop[0] - probe_start[0];
+	probe_hit = 0;
+
+	for (n = 0; n < BENCH_CALLS; n++) {
+		ProtoCounter::writeShiftRegister((sr_out_data_t)n * 0x9E3779B1UL);
+		ProtoCounter::update();
+#ifdef ANALOG_ENABLE
+		if (ACSR & (1<<ACIE)) {			// analog ramp has been started
+			ProtoCounter::setAnalogResolution((n >> 4) % ANALOG_OFF);
+			ANA_COMP_vect();
+		}
+#endif
+		collect();
+	}
+
+	for (n = 0; n < BENCH_CALLS; n++) {
+		int16_t val = (int16_t)(n % (MAX_DECIMAL - MIN_DECIMAL + 1)) + MIN_DECIMAL;
+		PROBE_START(PROBE_WRITE_INT);
+		ProtoCounter::writeInt(val);
+		PROBE_STOP(PROBE_WRITE_INT);
+		PROBE_START(PROBE_WRITE_LONG);
+		ProtoCounter::writeLong(val);
+		PROBE_STOP(PROBE_WRITE_LONG);
+		PROBE_START(PROBE_WRITE_L32);
+		ProtoCounter::writeLong((int32_t)((uint32_t)n * 0x9E3779B1UL));
+		PROBE_STOP(PROBE_WRITE_L32);
+		collect();
+	}
+	report();
+
+#ifndef PROTOCOUNTER_HOST
+	cli();								// simavr stops when the cpu sleeps
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);	// with interrupts disabled
+	sleep_enable();
+	sleep_cpu();
+#endif
+	return (0);
+}
@@ -0,0 +1,107 @@
+#!/bin/sh
+#
+# run_tests.sh
+#
+# Builds the host tests natively for the configurations they cover and
+# runs them. Each test prints its failed checks and returns non-zero on
+# failure. The script stops at the first failing build or test.
+#
+# requirements: g++ (or another C++ compiler, see CXX)
+#
+# environment:
+#   CXX    host compiler      (default g++)
+#   BUILD  build directory    (default ./build)
+
+CXX=${CXX:-g++}
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB="$HERE/../.."
+BUILD=${BUILD:-"$HERE/build"}
+mkdir -p "$BUILD" || exit 1
+
+CFLAGS="-DPROTOCOUNTER_HOST -DF_CPU=8000000UL -O2 -Wall -Wextra -I$LIB/host -I$LIB -I$HERE"
+
+run()
+# run(test, name, flags...)
+{
+	test=$1
+	name=$2
+	shift 2
+	echo "$name: $*"
+	$CXX $CFLAGS "$@" -o "$BUILD/$name" "$HERE/$test.cpp" "$LIB/ProtoCounter.cpp" \
+		"$LIB/host/host_io.cpp" || exit 1
+	"$BUILD/$name" || exit 1
+}
+
+# number output, with and without double buffer, and on 6 digits
+run test_display display
+run test_display display_double_buffer -DDISPLAY_DOUBLE_BUFFER
+run test_display display_ext -DEXT_DIGITS=3
+for mux in "" "-DMUX_TIMER1"; do
+	run test_double_buffer "double_buffer${mux:+_timer1}" -DDISPLAY_DOUBLE_BUFFER $mux
+done
+run test_marquee marquee -DMARQUEE
+run test_marquee marquee_double_buffer -DMARQUEE -DDISPLAY_DOUBLE_BUFFER -DMUX_TIMER1
+
+# 74HC595/74HC165 chains, both transfer modes must give the same results
+for transfer in bitbang usi; do
+	usi=""
+	[ "$transfer" = "usi" ] && usi="-DSH_REG_USI"
+	for bits in 8 12 16 32; do
+		run test_shift_register "sh_reg_${transfer}_${bits}" \
+			-DSH_REG_IN_BITCOUNT=$bits -DSH_REG_OUT_BITCOUNT=$bits $usi
+	done
+done
+
+for bits in 8 32; do
+	run test_debounce "debounce_$bits" -DSH_REG_DEBOUNCE -DSH_REG_IN_BITCOUNT=$bits
+done
+run test_debounce debounce_usi -DSH_REG_DEBOUNCE -DSH_REG_USI
+
+run test_input_counters input_counters_8 -DSH_REG_COUNTERS=8
+run test_input_counters input_counters_3 -DSH_REG_COUNTERS=3
+run test_input_counters input_counters_32 -DSH_REG_COUNTERS=32 -DSH_REG_IN_BITCOUNT=32
+run test_input_counters input_counters_debounce -DSH_REG_COUNTERS=8 -DSH_REG_DEBOUNCE
+
+run test_bcm bcm_4 -DSH_REG_BCM=4
+run test_bcm bcm_8 -DSH_REG_BCM=8 -DSH_REG_OUT_BITCOUNT=16
+run test_bcm bcm_5_usi -DSH_REG_BCM=5 -DSH_REG_OUT_BITCOUNT=32 -DSH_REG_USI
+
+for size in 2 8; do
+	run test_button_queue "button_queue_$size" -DBTN_EVENT_QUEUE=$size
+done
+
+run test_encoder encoder -DENCODER
+run test_encoder encoder_display -DENCODER -DENCODER_DISPLAY -DENCODER_A_BIT=4 -DENCODER_B_BIT=2
+
+for mux in "" "-DMUX_TIMER1"; do
+	run test_analog "analog${mux:+_timer1}" $mux
+done
+run test_analog analog_high_res -DANALOG_HIGH_RES
+
+run test_freq_meter freq_meter -DFREQ_METER
+
+for mux in "" "-DMUX_TIMER1"; do
+	run test_power_down "power_down${mux:+_timer1}" -DPOWER_MANAGER $mux
+done
+
+for buffer in 16 32; do
+	run test_serial "serial_tx$buffer" -DSWAP_PINS_PD01_FOR_PB01 -DSERIAL_BAUD=38400 \
+		-DSERIAL_TX_BUFFER=$buffer
+done
+run test_serial serial_sh_reg_16 -DSWAP_PINS_PD01_FOR_PB01 -DSERIAL_BAUD=38400 \
+	-DSH_REG_OUT_BITCOUNT=16
+
+run test_rate rate -DRATE_BINS=12
+run test_rate rate_5 -DRATE_BINS=5 -DRATE_BIN_TIME=7
+run test_rate rate_32 -DRATE_BINS=32 -DRATE_BIN_TIME=13 -DRATE_WINDOW=3
+
+run test_timers timers -DSOFT_TIMERS=4
+run test_timers timers_8 -DSOFT_TIMERS=8
+
+for size in 1 4 13 32; do
+	run test_eeprom "eeprom_$size" -DEEPROM_RECORD_SIZE=$size
+done
+run test_eeprom eeprom_ring -DEEPROM_RECORD_SIZE=4 -DEEPROM_RING_START=10 -DEEPROM_RING_END=100
+
+echo "all tests passed"
@@ -0,0 +1,75 @@
+/*
+ * sh_reg_chain.h
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Model of the shift register chains for the host tests
+					- chainModel() is a write hook (host_write_hook) that follows
+					  the clock and load signals of updateShiftRegister() in
+					  bit-bang and USI mode
+					- chain_outputs holds the latched outputs of the 74HC595 chain
+					- chain_inputs is applied to the parallel inputs of the
+					  74HC165 chain
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#ifndef PROTOCOUNTER_SH_REG_CHAIN_H_
+#define PROTOCOUNTER_SH_REG_CHAIN_H_
+
+#include <avr/io.h>
+#include "ProtoCounter.h"
+
+#define CHAIN_OUT_MASK	((SH_REG_OUT_BITCOUNT == 32) ? 0xFFFFFFFFUL : ((1UL << SH_REG_OUT_BITCOUNT) - 1))
+#define CHAIN_IN_MASK	((SH_REG_IN_BITCOUNT == 32) ? 0xFFFFFFFFUL : ((1UL << SH_REG_IN_BITCOUNT) - 1))
+
+static uint32_t	chain_outputs;			// 74HC595 output latch
+static uint32_t	chain_inputs;			// 74HC165 parallel inputs
+static uint32_t	chain_595, chain_165;	// shift registers
+static uint8_t	chain_clk = 1, chain_ld = 1, chain_data;
+
+
+static void chainModel(uint8_t, uint8_t, uint8_t)
+// called after every register write, updates the chains on the clock and load edges
+{
+	uint8_t c = (PORTB.value >> SH_REG_CLK_BIT) & 1;
+	uint8_t l = (SH_REG_LD_PORT.value >> SH_REG_LD_BIT) & 1;
+
+	if (chain_clk && !c) {				// data is valid at the falling clock edge
+#ifdef SH_REG_USI
+		chain_data = USIDR.value >> 7;
+#else
+		chain_data = (PORTB.value >> SH_REG_OUT_BIT) & 1;
+#endif
+	}
+	if (!chain_clk && c && l) {			// rising clock edge shifts both chains
+		chain_595 = (chain_595 << 1) | chain_data;
+		chain_165 <<= 1;
+	}
+	if (!l) { chain_165 = chain_inputs; }	// parallel load of the 165 while LD is low
+	if (!chain_ld && l) { chain_outputs = chain_595 & CHAIN_OUT_MASK; }	// rising LD edge latches the 595
+	chain_clk = c;
+	chain_ld = l;
+#if SH_REG_IN_BITCOUNT > 0
+	host_pin_input_b = (host_pin_input_b & ~(1 << SH_REG_IN_BIT))
+					 | (((chain_165 >> (SH_REG_IN_BITCOUNT - 1)) & 1) << SH_REG_IN_BIT);
+#endif
+}
+
+#endif /* PROTOCOUNTER_SH_REG_CHAIN_H_ */
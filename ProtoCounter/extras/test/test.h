@@ -0,0 +1,69 @@
+/*
+ * test.h
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Helpers for the host tests of the ProtoCounter library
+					- CHECK() reports a failed condition and counts it
+					- TEST_RESULT() prints the summary and is the exit code
+					- displayText() reads the display back as ASCII text
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+#ifndef PROTOCOUNTER_TEST_H_
+#define PROTOCOUNTER_TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+#include "ProtoCounter.h"
+
+static int test_failures = 0;
+
+#define CHECK(cond)		do { if (!(cond)) { test_failures++; \
+							printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); } \
+						} while (0)
+
+#define TEST_RESULT()	(printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"), \
+						 (test_failures != 0))
+
+
+static inline const char* displayText(void)
+// return the display content as text (leftmost digit first)
+// characters without a known pattern are shown as '?'
+{
+	static const struct { uint8_t pattern; char ch; } charset[] = {
+		{0x3F, '0'}, {0x06, '1'}, {0x5B, '2'}, {0x4F, '3'}, {0x66, '4'},
+		{0x6D, '5'}, {0x7D, '6'}, {0x07, '7'}, {0x7F, '8'}, {0x6F, '9'},
+		{0x76, 'k'}, {0x37, 'M'}, {0x3D, 'G'}, {0x40, '-'}, {0x00, ' '},
+		{0x71, 'F'}, {0x38, 'L'}, {0x3E, 'U'} };
+	static char text[MAX_DIGITS + 1];
+	uint8_t pos, pattern, i;
+
+	for (pos = 0; pos < MAX_DIGITS; pos++) {
+		pattern = ProtoCounter::getDisplay(MAX_DIGITS - 1 - pos);
+		text[pos] = '?';
+		for (i = 0; i < sizeof(charset) / sizeof(charset[0]); i++) {
+			if (charset[i].pattern == pattern) { text[pos] = charset[i].ch; }
+		}
+	}
+	text[MAX_DIGITS] = 0;
+	return (text);
+}
+
+#endif /* PROTOCOUNTER_TEST_H_ */
@@ -0,0 +1,175 @@
+/*
+ * test_analog.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the analog knob without the Arduino core
+					- the comparator fires a fixed time after each measurement
+					  has been started by update()
+					- getAnalog() must match that time in timer0 counts, also
+					  with MUX_TIMER1 where no sketch starts timer0
+					- the reduced resolutions must settle where the original
+					  shift-and-add filter settles
+					- ANALOG_HIGH_RES: getAnalogRaw() must match the time in
+					  timer1 counts (input capture) and getAnalog() must give
+					  step k in the middle of step k of the calibrated range
+					  for every resolution
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdlib.h>
+#include "test.h"
+
+#ifndef ANALOG_ENABLE
+#error "build with -DANALOG_ENABLE"
+#endif
+
+#ifdef ANALOG_HIGH_RES
+#define RAMP_CLOCK		8					// timer1 prescaler
+#define CAL_MIN			100					// calibration (timer1 counts)
+#define CAL_MAX			1700
+#else
+#define RAMP_CLOCK		64					// timer0 prescaler
+#define RAMP_COUNTS		100					// capacitor ramp-up time (timer0 counts)
+#endif
+
+static uint64_t	ramp_start;
+static uint8_t	ramp_running;
+static uint16_t	ramp_counts;
+
+
+#ifndef MUX_TIMER1
+ISR(TIMER0_COMPB_vect)
+{
+	sei();
+	ProtoCounter::update();
+}
+#endif
+
+
+static void comparatorModel(uint8_t addr, uint8_t, uint8_t val)
+// a measurement starts when update() enables the comparator interrupt
+{
+	if ((addr == 0x08) && (val & (1<<ACIE))) {	// ACSR
+		ramp_start = host_cycles;
+		ramp_running = 1;
+	}
+}
+
+
+static void measure(uint16_t ms)
+// run for "ms" milliseconds, the comparator fires after ramp_counts
+{
+	uint32_t i;
+
+	for (i = 0; i < F_CPU / 1000 / 8 * ms; i++) {
+		host_run_cycles(8);
+		if (ramp_running && (host_cycles - ramp_start >= (uint32_t)ramp_counts * RAMP_CLOCK)) {
+			ramp_running = 0;
+			host_comparator_event();
+		}
+	}
+}
+
+
+#ifndef ANALOG_HIGH_RES
+static uint8_t reference(uint8_t resolution, uint8_t rc)
+// value the original filter settles at for a constant ramp-up time rc
+{
+	uint16_t ana;
+	uint8_t  val = 0, i;
+
+	for (i = 0; i < 100; i++) {
+		ana = rc;
+		if (resolution == ANALOG_129_DETENT_STEPS) { ana += (rc >> 1); }
+		if (resolution == ANALOG_65_DETENT_STEPS)  { ana -= (rc >> 2); }
+		if (resolution == ANALOG_43_DETENT_STEPS)  { ana -= (rc >> 1); }
+		if (resolution == ANALOG_33_DETENT_STEPS)  { ana = (3 * ana) >> 3; }
+		if (resolution == ANALOG_22_DETENT_STEPS)  { ana >>= 2; }
+		val = (uint8_t)((ana + val + 2) >> 2);
+	}
+	return (val);
+}
+#endif
+
+
+int main(void)
+{
+	uint8_t res;
+
+	host_reset();
+	sei();
+	ProtoCounter::init();					// a plain build: nobody else starts timer0
+#ifndef MUX_TIMER1
+	TCCR0A = (1<<WGM01)|(1<<WGM00);			// the sketch runs timer0 like the Arduino core
+	TCCR0B = (1<<CS01)|(1<<CS00);
+	TIMSK |= (1<<OCIE0B);
+#endif
+	host_write_hook = comparatorModel;
+
+#ifdef ANALOG_HIGH_RES
+	static const uint8_t top[ANALOG_OFF] = {255, 128, 85, 64, 42, 32, 21};
+	uint16_t span = CAL_MAX - CAL_MIN;
+	uint8_t  k, step;
+
+	ProtoCounter::setAnalogCalibration(CAL_MIN, CAL_MAX);
+	ramp_counts = 1000;
+	measure(50);
+	CHECK(ProtoCounter::getAnalogRaw() >= ramp_counts);
+	CHECK(ProtoCounter::getAnalogRaw() <= ramp_counts + 2);
+
+	for (res = ANALOG_MAX_RESOLUTION; res < ANALOG_OFF; res++) {
+		ProtoCounter::setAnalogResolution(res);
+		for (step = 0; step < 5; step++) {
+			k = (uint8_t)((uint16_t)top[res] * step / 4);
+			// middle of step k, less the up to 2 counts the model fires late
+			ramp_counts = CAL_MIN + (uint16_t)(((2UL * k + 1) * span) / (2UL * (top[res] + 1))) - 1;
+			measure(20);
+			CHECK(ProtoCounter::getAnalog() == k);
+		}
+		ramp_counts = CAL_MIN / 2;			// outside of the calibrated range
+		measure(20);
+		CHECK(ProtoCounter::getAnalog() == 0);
+		ramp_counts = CAL_MAX + 100;
+		measure(20);
+		CHECK(ProtoCounter::getAnalog() == top[res]);
+	}
+	ProtoCounter::setAnalogResolution(ANALOG_OFF);
+	CHECK(ProtoCounter::getAnalog() == 0);
+#else
+	ramp_counts = RAMP_COUNTS;
+	ProtoCounter::setAnalogResolution(ANALOG_MAX_RESOLUTION);
+	measure(500);
+	CHECK(ProtoCounter::getAnalog() >= RAMP_COUNTS - 2);
+	CHECK(ProtoCounter::getAnalog() <= RAMP_COUNTS);
+
+	for (res = ANALOG_129_DETENT_STEPS; res < ANALOG_OFF; res++) {
+		ProtoCounter::setAnalogResolution(res);
+		measure(500);
+		CHECK(abs(ProtoCounter::getAnalog() - reference(res, RAMP_COUNTS - 1)) <= 1);
+	}
+	ProtoCounter::setAnalogResolution(ANALOG_OFF);
+	measure(100);
+	CHECK(ProtoCounter::getAnalog() == 0);
+#endif
+	return (TEST_RESULT());
+}
@@ -0,0 +1,117 @@
+/*
+ * test_bcm.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the dimmable outputs (SH_REG_BCM)
+					- the on-time of each output is counted in update cycles over
+					  whole pwm periods of 2^SH_REG_BCM - 1 cycles
+					- a duty value with a single bit k (one bit plane) must be
+					  on for 2^k cycles per period
+					- any duty value must be on for its upper SH_REG_BCM bits,
+					  set by setOutputDuty() or setOutputDuties()
+					- writeShiftRegister() switches outputs fully on or off
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+#include "sh_reg_chain.h"
+
+#ifndef SH_REG_BCM
+#error "build with -DSH_REG_BCM=<bits>"
+#endif
+
+#define PERIOD		((1 << SH_REG_BCM) - 1)	// update cycles per pwm period
+#define PERIODS		3						// measured periods
+
+static uint32_t	on_time[SH_REG_OUT_BITCOUNT];	// update cycles with the output on
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static void measure(void)
+// skip the period in which the duty values change, then count the on-time
+{
+	uint16_t n;
+	uint8_t  ch;
+
+	for (n = 0; n < PERIOD; n++) { ProtoCounter::update(); }
+	memset(on_time, 0, sizeof(on_time));
+	for (n = 0; n < PERIODS * PERIOD; n++) {
+		ProtoCounter::update();
+		for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+			if (chain_outputs & (1UL << ch)) { on_time[ch]++; }
+		}
+	}
+}
+
+
+int main(void)
+{
+	uint8_t duty[SH_REG_OUT_BITCOUNT];
+	uint8_t ch, k;
+
+	host_reset();
+	ProtoCounter::init();
+	host_write_hook = chainModel;
+
+	// every bit plane on its own, on all outputs
+	for (k = 0; k < SH_REG_BCM; k++) {
+		for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+			ProtoCounter::setOutputDuty(ch, (1 << k) << (8 - SH_REG_BCM));
+		}
+		measure();
+		for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+			CHECK(on_time[ch] == (uint32_t)PERIODS << k);
+		}
+	}
+
+	// random duty values, one by one and all at once
+	for (k = 0; k < 20; k++) {
+		for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+			duty[ch] = (uint8_t)random32();
+			if (k & 1) { ProtoCounter::setOutputDuty(ch, duty[ch]); }
+		}
+		if (!(k & 1)) { ProtoCounter::setOutputDuties(duty); }
+		measure();
+		for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+			CHECK(on_time[ch] == PERIODS * (uint32_t)(duty[ch] >> (8 - SH_REG_BCM)));
+		}
+	}
+
+	// fully on or off
+	ProtoCounter::writeShiftRegister((sr_out_data_t)0xA5C3E1F7UL);
+	measure();
+	for (ch = 0; ch < SH_REG_OUT_BITCOUNT; ch++) {
+		CHECK(on_time[ch] == (((0xA5C3E1F7UL >> ch) & 1) ? PERIODS * PERIOD : 0));
+	}
+	return (TEST_RESULT());
+}
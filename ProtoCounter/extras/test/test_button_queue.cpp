@@ -0,0 +1,147 @@
+/*
+ * test_button_queue.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the button event queue (BTN_EVENT_QUEUE)
+					- the buttons are pressed through the pin levels, update()
+					  is called directly
+					- the reference is getButton() (without the ack bit)
+					  compared after every update cycle: each change is an
+					  event, stamped with getTicks()
+					- popped events must equal the reference in order and time
+					- a queue that is not emptied keeps the first size-1
+					  events of a burst and drops the others, then accepts
+					  events again once it has been emptied
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+
+#ifndef BTN_EVENT_QUEUE
+#error "build with -DBTN_EVENT_QUEUE=<size>"
+#endif
+
+#define MAX_EVENTS	64
+
+static uint8_t	ref_event[MAX_EVENTS];		// reference events and their times
+static uint16_t	ref_time[MAX_EVENTS];
+static uint8_t	ref_count;
+static uint8_t	last_event;
+
+
+static void run(uint8_t pressed, uint16_t samples)
+// hold the buttons "pressed" for a number of sample intervals and record
+// each change of the button state as reference event
+{
+	uint16_t n;
+	uint8_t event;
+
+	host_pin_input_b = 0xFF & ~pressed;		// pressed buttons pull to common
+	for (n = 0; n < samples * BTN_SAMPLE_INTERVAL; n++) {
+		ProtoCounter::update();
+		event = ProtoCounter::getButton() & ~PB_ACK;
+		if (event != last_event) {
+			if (ref_count < MAX_EVENTS) {
+				ref_event[ref_count] = event;
+				ref_time[ref_count] = ProtoCounter::getTicks();
+				ref_count++;
+			}
+			last_event = event;
+		}
+	}
+}
+
+
+static void sequence(void)
+// short press, long press (acknowledged), both pressed
+{
+	run(BUTTON1, 3);
+	run(0, 2);
+	run(BUTTON2, BTN_LONGPRESS_DELAY + 5);
+	ProtoCounter::buttonAck();
+	run(BUTTON2, 2);
+	run(0, 2);
+	run(BUTTON1, 2);
+	run(BOTH_BTNS, 3);
+	run(BUTTON2, 2);
+	run(0, 2);
+}
+
+
+static void checkQueue(uint8_t count)
+// the first "count" reference events must be in the queue, nothing else
+{
+	uint16_t time;
+	uint8_t i;
+
+	for (i = 0; i < count; i++) {
+		time = 0xFFFF;
+		CHECK(ProtoCounter::popButtonEvent(&time) == ref_event[i]);
+		CHECK(time == ref_time[i]);
+	}
+	CHECK(ProtoCounter::popButtonEvent() == 0);
+	ref_count = 0;
+}
+
+
+int main(void)
+{
+	static const uint8_t sequence_events[] = {
+		BUTTON1 | PB_PRESS, BUTTON1,
+		BUTTON2 | PB_PRESS, BUTTON2 | PB_LONGPRESS, BUTTON2 | PB_LONG,
+		BUTTON1 | PB_PRESS, BOTH_PRESSED, BOTH_BTNS };
+	uint8_t i;
+
+	host_reset();
+	ProtoCounter::init();
+	run(0, 256 / BTN_SAMPLE_INTERVAL + 1);	// the first sample is 256 cycles after init()
+	CHECK(ref_count == 0);
+	CHECK(ProtoCounter::popButtonEvent() == 0);
+
+	// events popped right away
+	for (i = 0; i < 10; i++) {
+		run(i & 1 ? BUTTON2 : BUTTON1, 1);
+		CHECK(ref_count == 1);
+		checkQueue(1);
+		run(0, 1);
+		CHECK(ref_count == 1);
+		checkQueue(1);
+	}
+
+	// a burst that fits into the queue or exceeds it
+	sequence();
+	CHECK(ref_count == sizeof(sequence_events));
+	for (i = 0; i < sizeof(sequence_events); i++) {
+		CHECK(ref_event[i] == sequence_events[i]);
+	}
+	checkQueue(ref_count < BTN_EVENT_QUEUE - 1 ? ref_count : BTN_EVENT_QUEUE - 1);
+	for (i = 0; i < 2 * BTN_EVENT_QUEUE; i++) {
+		run(BUTTON1, 1);
+		run(0, 1);
+	}
+	checkQueue(BTN_EVENT_QUEUE - 1);
+
+	// the queue works again after it has been emptied
+	sequence();
+	checkQueue(ref_count < BTN_EVENT_QUEUE - 1 ? ref_count : BTN_EVENT_QUEUE - 1);
+	return (TEST_RESULT());
+}
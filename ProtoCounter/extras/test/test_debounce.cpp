@@ -0,0 +1,119 @@
+/*
+ * test_debounce.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the shift register input debouncing (SH_REG_DEBOUNCE)
+					- a clean step is taken over after exactly 4 transfers,
+					  shorter pulses are suppressed
+					- bouncing inputs are compared transfer by transfer with a
+					  plain counter per input: debounced state, rising and
+					  falling edges must match
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+#include "sh_reg_chain.h"
+
+#ifndef SH_REG_DEBOUNCE
+#error "build with -DSH_REG_DEBOUNCE"
+#endif
+
+#define LATENCY		4					// transfers until a change is taken over
+
+static uint32_t	ref_state, ref_rising, ref_falling;
+static uint8_t	ref_count[32];			// equal samples in a row per input
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static void transfer(void)
+// one update cycle (i.e. one transfer), the reference samples the same inputs
+{
+	uint32_t bit;
+	uint8_t  i;
+
+	ProtoCounter::update();
+	for (i = 0, bit = 1; i < SH_REG_IN_BITCOUNT; i++, bit <<= 1) {
+		if ((chain_inputs & bit) == (ref_state & bit)) {
+			ref_count[i] = 0;
+			continue;
+		}
+		if (++ref_count[i] < LATENCY) { continue; }
+		ref_count[i] = 0;
+		ref_state ^= bit;
+		if (ref_state & bit) { ref_rising |= bit; } else { ref_falling |= bit; }
+	}
+}
+
+
+int main(void)
+{
+	uint16_t n;
+	uint8_t  i;
+
+	host_reset();
+	ProtoCounter::init();
+	host_write_hook = chainModel;
+
+	// latency of a clean step and suppression of short pulses
+	chain_inputs = CHAIN_IN_MASK;
+	for (i = 1; i <= LATENCY; i++) {
+		transfer();
+		CHECK((uint32_t)ProtoCounter::readInputs() == ((i < LATENCY) ? 0 : CHAIN_IN_MASK));
+	}
+	CHECK((uint32_t)ProtoCounter::getRisingEdges() == CHAIN_IN_MASK);
+	CHECK(ProtoCounter::getRisingEdges() == 0);		// fetched
+	CHECK(ProtoCounter::getFallingEdges() == 0);
+	chain_inputs = 0;
+	for (i = 1; i < LATENCY; i++) { transfer(); }
+	chain_inputs = CHAIN_IN_MASK;
+	for (i = 0; i < 2 * LATENCY; i++) { transfer(); }
+	CHECK((uint32_t)ProtoCounter::readInputs() == CHAIN_IN_MASK);
+	CHECK(ProtoCounter::getFallingEdges() == 0);
+	ref_rising = 0;
+	ref_falling = 0;
+
+	// bouncing inputs: each input changes with a probability of 1/4 per
+	// transfer, so runs of every length occur
+	for (n = 0; n < 5000; n++) {
+		chain_inputs ^= random32() & random32() & CHAIN_IN_MASK;
+		transfer();
+		CHECK((uint32_t)ProtoCounter::readInputs() == ref_state);
+		if (n % 37 == 0) {
+			CHECK((uint32_t)ProtoCounter::getRisingEdges() == ref_rising);
+			CHECK((uint32_t)ProtoCounter::getFallingEdges() == ref_falling);
+			ref_rising = 0;
+			ref_falling = 0;
+		}
+	}
+	return (TEST_RESULT());
+}
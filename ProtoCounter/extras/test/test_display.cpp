@@ -0,0 +1,162 @@
+/*
+ * test_display.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Golden test of the number output
+					- writeInt(), writeLong() and writeFixed() are compared with
+					  the expected display text for values around every change
+					  of the digit count, unit prefix and sign
+					- golden values for 3 digits and for 6 digits (EXT_DIGITS=3)
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+
+#define INT		0
+#define LONG	1
+#define FIXED	2
+
+struct golden_t {
+	uint8_t		function;
+	int32_t		val;
+	uint8_t		decimals;				// writeFixed(): argument, otherwise setDecimalPlaces()
+	const char*	text;
+};
+
+static const golden_t golden[] = {
+#if MAX_DIGITS == 3
+	{INT,	0,				0,	"  0"},
+	{INT,	7,				0,	"  7"},
+	{INT,	999,			0,	"999"},
+	{INT,	1000,			0,	"0FL"},
+	{INT,	-1,				0,	"- 1"},
+	{INT,	-99,			0,	"-99"},
+	{INT,	-100,			0,	"UFL"},
+	{INT,	5,				2,	"005"},
+	{INT,	-5,				1,	"-05"},
+
+	{LONG,	0,				0,	"  0"},
+	{LONG,	42,				0,	" 42"},
+	{LONG,	999,			0,	"999"},
+	{LONG,	1000,			0,	"1k0"},
+	{LONG,	1234,			0,	"1k2"},
+	{LONG,	9999,			0,	"9k9"},
+	{LONG,	10000,			0,	"10k"},
+	{LONG,	99999,			0,	"99k"},
+	{LONG,	100000,			0,	"M10"},
+	{LONG,	123456,			0,	"M12"},
+	{LONG,	1000000,		0,	"1M0"},
+	{LONG,	9876543,		0,	"9M8"},
+	{LONG,	12345678,		0,	"12M"},
+	{LONG,	123456789,		0,	"G12"},
+	{LONG,	2147483647,		0,	"2G1"},
+	{LONG,	-1,				0,	"- 1"},
+	{LONG,	-99,			0,	"-99"},
+	{LONG,	-100,			0,	"-k1"},
+	{LONG,	-1234,			0,	"-1k"},
+	{LONG,	-123456,		0,	"-M1"},
+	{LONG,	-2147483647-1,	0,	"-2G"},
+	{LONG,	5,				2,	"005"},
+	{LONG,	999,			2,	"999"},
+	{LONG,	1234,			2,	" 12"},		// integer part fits
+	{LONG,	12345,			2,	"123"},
+	{LONG,	123456,			2,	"1k2"},		// integer part is auto-ranged
+	{LONG,	-1234,			2,	"-12"},
+
+	{FIXED,	5,				2,	"005"},
+	{FIXED,	999,			2,	"999"},
+	{FIXED,	1234,			2,	" 12"},
+	{FIXED,	12345,			2,	"123"},
+	{FIXED,	99999,			2,	"999"},
+	{FIXED,	100000,			2,	"1k0"},
+	{FIXED,	1000,			1,	"100"},
+	{FIXED,	12345,			1,	"1k2"},
+	{FIXED,	-5,				1,	"-05"},
+	{FIXED,	-123,			2,	"- 1"},
+	{FIXED,	-1234,			2,	"-12"},
+	{FIXED,	-12345,			2,	"-k1"},
+	{FIXED,	500,			3,	"  0"},		// more decimals than digits
+	{FIXED,	7300,			3,	"  7"},
+	{FIXED,	-7300,			3,	"- 7"},
+	{FIXED,	45000000,		3,	"45k"},
+#elif MAX_DIGITS == 6
+	{INT,	0,				0,	"     0"},
+	{INT,	-1,				0,	"    -1"},
+	{INT,	-99,			0,	"   -99"},
+	{INT,	32767,			0,	" 32767"},
+	{INT,	-32768,			0,	"-32768"},
+	{INT,	-1,				2,	"  -001"},
+
+	{LONG,	-100,			0,	"  -100"},
+	{LONG,	-99999,			0,	"-99999"},
+	{LONG,	-100000,		0,	"-100k0"},
+	{LONG,	999999,			0,	"999999"},
+	{LONG,	1000000,		0,	"1000k0"},
+	{LONG,	1234567,		0,	"1234k5"},
+	{LONG,	-2147483647-1,	0,	"-2147M"},
+	{LONG,	1234567,		2,	" 12345"},
+	{LONG,	-123456,		2,	" -1234"},
+	{LONG,	-1234567,		2,	"-12345"},
+
+	{FIXED,	-5,				2,	"  -005"},
+	{FIXED,	-123,			2,	"  -123"},
+	{FIXED,	-12345,			5,	"-12345"},
+	{FIXED,	-12345678,		2,	"-123k4"},
+	{FIXED,	500,			3,	"  0500"},
+	{FIXED,	45000000,		3,	" 45000"},
+	{FIXED,	1234567,		6,	"     1"},	// more decimals than digits
+	{FIXED,	-500,			6,	"    -0"},
+#endif
+};
+
+
+int main(void)
+{
+	uint8_t i;
+
+	host_reset();
+	ProtoCounter::init();
+
+	for (i = 0; i < sizeof(golden) / sizeof(golden[0]); i++) {
+		if (golden[i].function == FIXED) {
+			ProtoCounter::setDecimalPlaces(0);
+			ProtoCounter::writeFixed(golden[i].val, golden[i].decimals);
+		}
+		else {
+			ProtoCounter::setDecimalPlaces(golden[i].decimals);
+			if (golden[i].function == INT) {
+				ProtoCounter::writeInt((int16_t)golden[i].val);
+			}
+			else {
+				ProtoCounter::writeLong(golden[i].val);
+			}
+		}
+		if (strcmp(displayText(), golden[i].text) != 0) {
+			printf("%s(%ld) with %u decimal places: \"%s\", expected \"%s\"\n",
+				   (golden[i].function == INT) ? "writeInt" :
+				   (golden[i].function == LONG) ? "writeLong" : "writeFixed",
+				   (long)golden[i].val, golden[i].decimals, displayText(), golden[i].text);
+			test_failures++;
+		}
+	}
+	return (TEST_RESULT());
+}
@@ -0,0 +1,150 @@
+/*
+ * test_double_buffer.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the double buffered display (DISPLAY_DOUBLE_BUFFER)
+					- random frames (setDisplay() inside beginFrame() ...
+					  commitFrame(), also nested) are interleaved with update()
+					- the lit digit and its segments are read from the port
+					  pins after every update()
+					- the reference keeps the last committed frame and the
+					  shown frame: at a frame boundary the committed frame is
+					  shown unless a new frame has been begun
+					- every multiplexing frame must show one frame only
+					  (never half-updated), with and without dimming
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+
+#ifndef DISPLAY_DOUBLE_BUFFER
+#error "build with -DDISPLAY_DOUBLE_BUFFER"
+#endif
+
+static uint8_t	committed[MAX_DIGITS];		// led patterns of the last committed frame
+static uint8_t	working[MAX_DIGITS];		// frame being written
+static uint8_t	shown[MAX_DIGITS];			// frame that has to be on the display
+static uint8_t	depth;						// nesting level of beginFrame()
+static int8_t	last_lit = 0;				// digit lit by the last update()
+static uint32_t	digits_checked;
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static int8_t litDigit(void)
+// display position whose anode is on, -1 if none
+{
+	static const uint8_t anode[3] = { ANODE3, ANODE2, ANODE1 };
+	int8_t pos;
+
+	for (pos = 0; pos < 3; pos++) {
+		if (!(ANODE_PORT.value & (1 << anode[pos]))) { return (pos); }
+	}
+	return (-1);
+}
+
+
+static void update(void)
+// one update cycle, compared with the reference
+{
+	int8_t lit;
+
+	ProtoCounter::update();
+	lit = litDigit();
+	if ((lit < 0) && (last_lit == 0)) {		// first blank cycle = frame boundary
+		if (depth == 0) { memcpy(shown, committed, MAX_DIGITS); }
+	}
+	if (lit >= 0) {
+		CHECK(PORTD.value == (uint8_t)~shown[lit]);
+		digits_checked++;
+	}
+	last_lit = lit;
+}
+
+
+static void writeFrames(uint16_t count)
+// random frame writes between update cycles
+{
+	uint8_t pos, pattern;
+	uint16_t i;
+
+	for (i = 0; i < count; i++) {
+		switch (random32() % 6) {
+		case 0:									// begin a (nested) frame
+			if (depth < 3) {
+				if (depth++ == 0) { memcpy(working, committed, MAX_DIGITS); }
+				ProtoCounter::beginFrame();
+			}
+			break;
+		case 1:									// commit it
+			ProtoCounter::commitFrame();
+			if (depth && (--depth == 0)) { memcpy(committed, working, MAX_DIGITS); }
+			break;
+		case 2:									// write a digit (a frame of its own if none is open)
+			pos = random32() % MAX_DIGITS;
+			pattern = (uint8_t)random32();
+			ProtoCounter::setDisplay(pattern, pos);
+			if (depth) { working[pos] = pattern; }
+			else { committed[pos] = pattern; }
+			break;
+		default:
+			update();
+			break;
+		}
+		for (pos = 0; pos < MAX_DIGITS; pos++) {	// latest content
+			CHECK(ProtoCounter::getDisplay(pos) == (depth ? working[pos] : committed[pos]));
+		}
+	}
+}
+
+
+int main(void)
+{
+	host_reset();
+	ProtoCounter::init();
+
+	writeFrames(20000);
+	ProtoCounter::setDimming(3);
+	writeFrames(20000);
+
+	if (depth) {								// close all frames, everything gets shown
+		while (depth) {
+			ProtoCounter::commitFrame();
+			depth--;
+		}
+		memcpy(committed, working, MAX_DIGITS);
+	}
+	for (uint8_t i = 0; i < 20; i++) { update(); }
+	CHECK(memcmp(shown, committed, MAX_DIGITS) == 0);
+	CHECK(digits_checked > 5000);
+	return (TEST_RESULT());
+}
@@ -0,0 +1,125 @@
+/*
+ * test_eeprom.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the EEPROM records (EEPROM_RECORD_SIZE)
+					- saveRecord() / loadRecord() across simulated resets while
+					  the ring wraps around several times
+					- power is cut at many points during a save: loadRecord()
+					  must return either the old or the new record, also if the
+					  checksum of the interrupted slot happens to match
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+
+#ifndef EEPROM_RECORD_SIZE
+#error "build with -DEEPROM_RECORD_SIZE=<bytes>"
+#endif
+
+#define SLOT_SIZE		(EEPROM_RECORD_SIZE + 2)
+#define SAVE_CYCLES		(SLOT_SIZE * 27200UL)	// 3.4 ms per byte
+
+
+static void makeRecord(uint8_t* record, uint32_t val)
+// fill a record with a pattern that depends on every bit of val
+{
+	uint8_t i;
+
+	for (i = 0; i < EEPROM_RECORD_SIZE; i++) {
+		record[i] = (uint8_t)(val >> (8 * (i % 4))) + i / 4;
+	}
+}
+
+
+static void forgeChecksum(const uint8_t* before)
+// Make the checksum of the slot that was being written match its torn
+// content, as if the old checksum fitted by chance.
+{
+	uint16_t addr, slot;
+	uint8_t  i, sum = 0;
+
+	for (addr = EEPROM_RING_START; addr <= EEPROM_RING_END; addr++) {
+		if (host_eeprom[addr] != before[addr]) { break; }
+	}
+	if (addr > EEPROM_RING_END) { return; }	// nothing written yet
+	slot = EEPROM_RING_START + (addr - EEPROM_RING_START) / SLOT_SIZE * SLOT_SIZE;
+	for (i = 0; i < SLOT_SIZE - 1; i++) { sum += host_eeprom[slot + i]; }
+	host_eeprom[slot + SLOT_SIZE - 1] = ~sum;
+}
+
+
+static void powerUp(void)
+// reset the controller, the EEPROM content survives
+{
+	host_reset();
+	sei();
+	ProtoCounter::init();
+}
+
+
+int main(void)
+{
+	uint8_t		record[EEPROM_RECORD_SIZE], old_rec[EEPROM_RECORD_SIZE], new_rec[EEPROM_RECORD_SIZE];
+	uint8_t		before[E2END + 1];
+	uint32_t	val = 1000, cut;
+	uint16_t	lap;
+	uint8_t		complete, forge;
+
+	powerUp();
+	CHECK(ProtoCounter::loadRecord(record) == 0);	// erased EEPROM holds no record
+
+	for (lap = 0; lap < 300; lap++) {
+		val++;
+		makeRecord(new_rec, val);
+		CHECK(ProtoCounter::saveRecord(new_rec) != 0);
+		CHECK(ProtoCounter::saveRecord(new_rec) == 0);		// busy
+		while (ProtoCounter::isSaving()) { host_run_cycles(100); }
+		if (lap % 37 == 0) {
+			powerUp();
+			CHECK(ProtoCounter::loadRecord(record) != 0);
+			CHECK(memcmp(record, new_rec, EEPROM_RECORD_SIZE) == 0);
+		}
+	}
+
+	for (forge = 0; forge < 2; forge++) {
+	for (cut = 1; cut < SAVE_CYCLES + 100; cut += 7919) {
+		makeRecord(old_rec, val);
+		makeRecord(new_rec, ~val);			// every byte differs
+		memcpy(before, host_eeprom, sizeof(before));
+		ProtoCounter::saveRecord(new_rec);
+		host_run_cycles(cut);
+		complete = !ProtoCounter::isSaving();
+		powerUp();
+		if (forge && !complete) { forgeChecksum(before); }
+		ProtoCounter::loadRecord(record);
+		CHECK((memcmp(record, old_rec, EEPROM_RECORD_SIZE) == 0) ||
+			  (memcmp(record, new_rec, EEPROM_RECORD_SIZE) == 0));
+		if (complete) {
+			CHECK(memcmp(record, new_rec, EEPROM_RECORD_SIZE) == 0);
+		}
+		if (memcmp(record, new_rec, EEPROM_RECORD_SIZE) == 0) { val = ~val; }
+	}
+	}
+	return (TEST_RESULT());
+}
@@ -0,0 +1,180 @@
+/*
+ * test_encoder.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the quadrature encoder (ENCODER)
+					- the signals A and B are driven through the pin levels,
+					  each change is served by the pin change interrupt
+					- all 16 transitions (old A, B -> new A, B) are compared
+					  with the gray code sequence 00, 01, 11, 10: one quarter
+					  step forward or backward, no step, or an error if both
+					  signals changed
+					- a random walk is compared with a plain quarter step
+					  count, divided with rounding by 1, 2 and 4 for every
+					  resolution, also across resetEncoder()
+					- with ENCODER_DISPLAY, update() leaves the display alone
+					  and pollEncoder() shows the position
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+
+#ifndef ENCODER
+#error "build with -DENCODER"
+#endif
+
+#define PIN_MASK	((1 << ENCODER_A_BIT) | (1 << ENCODER_B_BIT))
+
+static const uint8_t sequence[4] = { 0, 1, 3, 2 };	// forward (A = bit 1, B = bit 0)
+
+static uint8_t	state;						// current level of A and B
+static int32_t	quarter_steps;				// reference position
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static void setState(uint8_t new_state)
+// drive A and B, and let the pin change interrupt run
+{
+	uint8_t level = host_pin_input_b & ~PIN_MASK;
+
+	if (new_state & 2) { level |= (1 << ENCODER_A_BIT); }
+	if (new_state & 1) { level |= (1 << ENCODER_B_BIT); }
+	host_pin_input_b = level;
+	host_run_cycles(32);
+	state = new_state;
+}
+
+
+static uint8_t position(uint8_t st)
+// index of a state in the forward sequence
+{
+	uint8_t i;
+
+	for (i = 0; st != sequence[i]; i++) { }
+	return (i);
+}
+
+
+static void step(int8_t dir)
+// one quarter step forward (+1) or backward (-1)
+{
+	setState(sequence[(position(state) + dir) & 3]);
+	quarter_steps += dir;
+}
+
+
+static int32_t divide(int32_t steps, uint8_t res)
+// quarter steps -> counts at resolution "res", halves are rounded up
+{
+	int32_t div = 1L << res;
+	int32_t q = steps / div, r = steps % div;
+
+	if (r < 0) { q--; r += div; }				// floor division
+	if (2 * r >= div) { q++; }
+	return (q);
+}
+
+
+int main(void)
+{
+	uint8_t from, to, res;
+	int32_t before, pos;
+	uint16_t i;
+
+	host_reset();
+	host_pin_input_b = 0xFF;
+	state = 3;									// pull-ups: A = B = high
+	sei();
+	ProtoCounter::init();
+	ProtoCounter::setEncoderResolution(ENCODER_4X);
+	CHECK(ProtoCounter::getEncoder() == 0);
+
+	// all 16 transitions
+	for (from = 0; from < 4; from++) {
+		for (to = 0; to < 4; to++) {
+			while (state != from) { step(+1); }	// legal way to the start state
+			before = ProtoCounter::getEncoder();
+			CHECK(ProtoCounter::getEncoderErrors() == 0);
+			setState(to);
+			switch ((position(to) - position(from)) & 3) {
+			case 0:	CHECK(ProtoCounter::getEncoder() == before);		break;
+			case 1:	CHECK(ProtoCounter::getEncoder() == before + 1);	break;
+			case 3:	CHECK(ProtoCounter::getEncoder() == before - 1);	break;
+			case 2:	CHECK(ProtoCounter::getEncoder() == before);
+					CHECK(ProtoCounter::getEncoderErrors() == 1);		break;
+			}
+			CHECK(ProtoCounter::getEncoderErrors() == 0);
+		}
+	}
+
+	// random walk at every resolution
+	ProtoCounter::resetEncoder();
+	quarter_steps = 0;
+	for (i = 0; i < 3000; i++) {
+		step((random32() & 1) ? +1 : -1);
+		if (i % 7 == 0) { step(+1); }			// drift forward, the position also gets large
+		res = i % 3;
+		ProtoCounter::setEncoderResolution(res);
+		CHECK(ProtoCounter::getEncoder() == divide(quarter_steps, res));
+		if (i % 97 == 0) {
+			pos = ProtoCounter::resetEncoder();
+			CHECK(pos == divide(quarter_steps, res));
+			quarter_steps -= pos << res;		// the fraction is kept
+			CHECK(ProtoCounter::getEncoder() == 0);
+		}
+	}
+	CHECK(ProtoCounter::getEncoderErrors() == 0);
+	ProtoCounter::setEncoderResolution(ENCODER_1X + 1);	// invalid, ignored
+	CHECK(ProtoCounter::getEncoder() == divide(quarter_steps, ENCODER_1X));
+
+#ifdef ENCODER_DISPLAY
+	// the display is only written by pollEncoder()
+	char text[MAX_DIGITS + 1];
+
+	CHECK(ProtoCounter::pollEncoder() == 1);
+	CHECK(ProtoCounter::pollEncoder() == 0);
+	ProtoCounter::setEncoderResolution(ENCODER_4X);
+	ProtoCounter::resetEncoder();
+	quarter_steps = 0;
+	ProtoCounter::writeLong(-99);
+	strcpy(text, displayText());
+	for (i = 0; i < 12; i++) { step(+1); }
+	for (i = 0; i < 1000; i++) { ProtoCounter::update(); }
+	CHECK(strcmp(displayText(), text) == 0);
+	CHECK(ProtoCounter::pollEncoder() == 1);
+	CHECK(strcmp(displayText(), " 12") == 0);
+	CHECK(ProtoCounter::pollEncoder() == 0);
+#endif
+	return (TEST_RESULT());
+}
@@ -0,0 +1,136 @@
+/*
+ * test_freq_meter.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the frequency meter (FREQ_METER)
+					- feeds square waves of 0.5 Hz to 45 kHz into the FREQ_BIT pin
+					- getFrequency() and getPeriod() must be within 0.01 %
+					- writeFrequency() must show the frequency in Hz
+					- without a signal getFrequency() must drop to 0 after the
+					  timeout
+					- falling edges right after the compare match, alternately
+					  before and after update() has counted the tick, must not
+					  shift the time stamps
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+
+#ifndef FREQ_METER
+#error "build with -DFREQ_METER"
+#endif
+
+
+#define GAP_EDGE_TICKS	7				// ticks between two edges of the gap test
+
+static uint8_t	gap_test;
+static uint16_t	gap_ticks;
+
+
+static void gapEdge(uint8_t phase)
+// toggle the input in phase 0 and 1 before update(), in phase 2 and 3 after it,
+// i.e. falling edges alternate between both sides of ticks++
+{
+	if (gap_ticks % GAP_EDGE_TICKS) { return; }
+	if (((gap_ticks / GAP_EDGE_TICKS) & 2) == phase) {
+		host_pin_input_b ^= (1<<FREQ_BIT);
+		host_run_cycles(32);			// pin change interrupt is served here
+	}
+}
+
+
+ISR(TIMER0_COMPB_vect)
+{
+	sei();
+	if (gap_test) { gapEdge(0); }		// interrupt entered, update() not yet called
+	ProtoCounter::update();
+	if (gap_test) { gapEdge(2); }
+	gap_ticks++;
+}
+
+
+static void squareWave(double hz, double seconds)
+// toggle the input pin at the given frequency while the simulation runs
+{
+	double		half_period = F_CPU / hz / 2, next = half_period;
+	uint64_t	start = host_cycles, end = host_cycles + (uint64_t)(seconds * F_CPU);
+	double		now, step;
+
+	while (host_cycles < end) {
+		now = (double)(host_cycles - start);
+		if (now >= next) {
+			host_pin_input_b ^= (1<<FREQ_BIT);
+			next += half_period;
+		}
+		step = next - now;
+		if (step < 1) { step = 1; }
+		if (step > 1000) { step = 1000; }
+		host_run_cycles((uint32_t)step);
+	}
+}
+
+
+static int withinTolerance(double measured, double expected)
+// 0.01 %, at least one unit of the result
+{
+	double tolerance = expected * 0.0001;
+
+	if (tolerance < 1) { tolerance = 1; }
+	return ((measured >= expected - tolerance) && (measured <= expected + tolerance));
+}
+
+
+int main(void)
+{
+	static const double frequency[] = { 0.5, 7.3, 50, 1234.5, 20000, 45000 };
+	// writeFrequency(), 0 = too close to a digit boundary (digits are truncated)
+	static const char* const text[] = { "  0", "  7", 0, "1k2", 0, 0 };
+	uint8_t i;
+
+	host_reset();
+	TCCR0A = (1<<WGM01)|(1<<WGM00);		// timer0 as set up by the Arduino core
+	TCCR0B = (1<<CS01)|(1<<CS00);
+	sei();
+	ProtoCounter::init();
+	TIMSK |= (1<<OCIE0B);
+
+	for (i = 0; i < sizeof(frequency) / sizeof(frequency[0]); i++) {
+		squareWave(frequency[i], (frequency[i] < 1) ? 8 : 3);
+		CHECK(withinTolerance(ProtoCounter::getFrequency(), frequency[i] * 1000));	// mHz
+		CHECK(withinTolerance(ProtoCounter::getPeriod(), 1e6 / frequency[i]));		// us
+		if (text[i]) {
+			ProtoCounter::writeFrequency();
+			CHECK(strcmp(displayText(), text[i]) == 0);
+		}
+	}
+	host_run_cycles((uint32_t)(F_CPU * 11));
+	CHECK(ProtoCounter::getFrequency() == 0);
+
+	gap_test = 1;
+	host_run_cycles((uint32_t)F_CPU);
+	for (i = 0; i < 24; i++) {			// gates with an odd and an even number of periods
+		host_run_cycles((uint32_t)(F_CPU / 4));
+		CHECK(withinTolerance(ProtoCounter::getFrequency(), F_CPU / 64.0 / 256 * 1000 / (2 * GAP_EDGE_TICKS)));
+	}
+	return (TEST_RESULT());
+}
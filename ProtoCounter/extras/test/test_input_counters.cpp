@@ -0,0 +1,118 @@
+/*
+ * test_input_counters.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the bit-sliced shift register input counters
+					(SH_REG_COUNTERS)
+					- random inputs are counted by the library and by a plain
+					  counter per channel, getInputCount() and resetInputCount()
+					  must match the plain counters at any time
+					- inputs that are high at power-up are not counted (counted
+					  once with SH_REG_DEBOUNCE)
+					- inputs above SH_REG_COUNTERS are not counted
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+#include "sh_reg_chain.h"
+
+#ifndef SH_REG_COUNTERS
+#error "build with -DSH_REG_COUNTERS=<channels>"
+#endif
+
+#ifdef SH_REG_DEBOUNCE
+#define HOLD		6					// transfers per input pattern (> debounce time)
+#else
+#define HOLD		1
+#endif
+
+static uint32_t	count[SH_REG_COUNTERS];	// plain counter per channel
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static void apply(uint32_t inputs, uint32_t* last)
+// apply an input pattern for HOLD transfers and count its rising edges
+{
+	uint8_t ch;
+
+	chain_inputs = inputs & CHAIN_IN_MASK;
+	for (ch = 0; ch < SH_REG_COUNTERS; ch++) {
+		if ((chain_inputs & ~*last) & (1UL << ch)) { count[ch]++; }
+	}
+	*last = chain_inputs;
+	for (ch = 0; ch < HOLD; ch++) { ProtoCounter::update(); }
+}
+
+
+int main(void)
+{
+	uint32_t last;
+	uint16_t n;
+	uint8_t  ch;
+
+	host_reset();
+	ProtoCounter::init();
+	host_write_hook = chainModel;
+
+	// all inputs high at power-up
+#ifdef SH_REG_DEBOUNCE
+	last = 0;							// the debounced state starts low
+#else
+	last = CHAIN_IN_MASK;
+#endif
+	apply(CHAIN_IN_MASK, &last);
+	for (n = 0; n < 2 * SH_REG_COUNTERS; n++) { ProtoCounter::update(); }
+	for (ch = 0; ch < SH_REG_COUNTERS; ch++) {
+		CHECK(ProtoCounter::getInputCount(ch) == count[ch]);
+	}
+	CHECK(ProtoCounter::getInputCount(SH_REG_COUNTERS) == 0);
+
+	// random inputs, every input toggles as often as possible at times
+	for (n = 0; n < 4000; n++) {
+		apply((n & 0x100) ? ~last : random32(), &last);
+		if (n % 13 == 0) {
+			ch = (uint8_t)(random32() % SH_REG_COUNTERS);
+			CHECK(ProtoCounter::getInputCount(ch) == count[ch]);
+		}
+		if (n % 97 == 0) {
+			ch = (uint8_t)(random32() % SH_REG_COUNTERS);
+			CHECK(ProtoCounter::resetInputCount(ch) == count[ch]);
+			count[ch] = 0;
+		}
+	}
+	for (ch = 0; ch < SH_REG_COUNTERS; ch++) {
+		CHECK(ProtoCounter::getInputCount(ch) == count[ch]);
+	}
+	CHECK(ProtoCounter::getInputCount(SH_REG_COUNTERS) == 0);
+	return (TEST_RESULT());
+}
@@ -0,0 +1,159 @@
+/*
+ * test_marquee.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the scrolling text (MARQUEE)
+					- the reference is the former display content followed
+					  by the text and MAX_DIGITS blanks: after k steps the
+					  display shows MAX_DIGITS characters of it from position k
+					  (every step has to change the display to be detected)
+					- step k must happen at the first frame boundary after
+					  k * speed update cycles (speed >= cycles per frame)
+					- the callback is called once, when the text has passed,
+					  then the marquee stops
+					- texts in RAM and in flash memory, stopMarquee() and a
+					  restart while scrolling (also while a step is pending)
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "test.h"
+
+#ifndef MARQUEE
+#error "build with -DMARQUEE"
+#endif
+
+#define FRAME_CYCLES	(MAX_DIGITS + 1)	// update cycles per frame without dimming
+#define MAX_TEXT		40
+
+static char		reference[MAX_TEXT + MAX_DIGITS + 1];
+static uint8_t	callbacks;
+
+
+static void marqueeDone(void)
+{
+	callbacks++;
+}
+
+
+static void expectText(const char* st)
+// reference = text followed by blanks (after the former display content)
+{
+	strcpy(reference, st);
+	memset(reference + strlen(st), ' ', MAX_DIGITS);
+	reference[strlen(st) + MAX_DIGITS] = 0;
+}
+
+
+static uint8_t shows(const uint8_t* former, uint8_t k)
+// compare the display with the reference after k steps
+{
+	uint8_t i, pattern;
+
+	for (i = 0; i < MAX_DIGITS; i++) {
+		if (k + i < MAX_DIGITS) { pattern = former[k + i]; }
+		else { pattern = ProtoCounter::charToPattern(reference[k + i - MAX_DIGITS]); }
+		if (ProtoCounter::getDisplay(MAX_DIGITS - 1 - i) != pattern) { return (0); }
+	}
+	return (1);
+}
+
+
+static void scroll(const char* st, uint8_t flash, uint16_t speed, uint16_t stop_after)
+// run a marquee (stopped or restarted after "stop_after" steps if not 0)
+// and compare every update cycle with the reference
+{
+	uint8_t former[MAX_DIGITS];
+	uint8_t i, k = 0, steps;
+	uint32_t n;
+
+	for (i = 0; i < MAX_DIGITS; i++) {
+		former[i] = ProtoCounter::getDisplay(MAX_DIGITS - 1 - i);
+	}
+	expectText(st);
+	steps = strlen(reference);
+	callbacks = 0;
+	if (flash) { ProtoCounter::startMarquee_P(st, speed, marqueeDone); }
+	else { ProtoCounter::startMarquee(st, speed, marqueeDone); }
+
+	for (n = 1; n <= (uint32_t)(steps + 2) * speed + FRAME_CYCLES; n++) {
+		ProtoCounter::update();
+		if ((k < steps) && !shows(former, k)) {		// next step
+			k++;
+			CHECK(shows(former, k));
+			CHECK((n >= (uint32_t)k * speed) && (n < (uint32_t)k * speed + FRAME_CYCLES));
+			if (k == stop_after) { return; }
+		}
+		CHECK(ProtoCounter::isMarqueeRunning() == (k < steps));
+		CHECK(callbacks == (k == steps));
+	}
+	CHECK(k == steps);
+}
+
+
+int main(void)
+{
+	static const char flash_text[] PROGMEM = "F1234567890-LU";
+	static char text[MAX_TEXT];
+	uint8_t former[MAX_DIGITS];
+	uint8_t i;
+	uint16_t n;
+
+	host_reset();
+	ProtoCounter::init();
+	ProtoCounter::setDimming(0);
+	for (n = 0; n < 100; n++) { ProtoCounter::update(); }
+
+	ProtoCounter::writeLong(-42);
+	strcpy(text, "12-345");
+	scroll(text, 0, FRAME_CYCLES, 0);
+	strcpy(text, "9876543210");
+	scroll(text, 0, 37, 0);
+	scroll(flash_text, 1, 100, 0);
+	scroll("8", 0, FRAME_CYCLES + 1, 0);
+	ProtoCounter::writeLong(-7);				// every step has to change the display
+	scroll("", 0, 10, 0);
+
+	// stopped while scrolling, the display keeps its content
+	ProtoCounter::writeLong(123);
+	scroll("4567", 0, 20, 3);
+	ProtoCounter::stopMarquee();
+	for (i = 0; i < MAX_DIGITS; i++) {
+		former[i] = ProtoCounter::getDisplay(i);
+	}
+	for (n = 0; n < 500; n++) { ProtoCounter::update(); }
+	CHECK(!ProtoCounter::isMarqueeRunning());
+	CHECK(callbacks == 0);
+	for (i = 0; i < MAX_DIGITS; i++) {
+		CHECK(ProtoCounter::getDisplay(i) == former[i]);
+	}
+
+	// restarted while scrolling, also right when a step is due
+	scroll("4567", 0, 20, 2);
+	scroll("89", 0, 15, 0);
+	for (i = 0; i < FRAME_CYCLES; i++) {
+		ProtoCounter::startMarquee("4567", 20 + i);
+		for (n = 0; n < 20 + i; n++) { ProtoCounter::update(); }
+		scroll("89", 0, 15, 0);
+	}
+	return (TEST_RESULT());
+}
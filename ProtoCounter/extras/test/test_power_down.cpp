@@ -0,0 +1,115 @@
+/*
+ * test_power_down.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of powerDown() (POWER_MANAGER)
+					- every write of MCUCR takes long enough for a timer compare
+					  match, i.e. update() may run between the pin setup and the
+					  start of the sleep
+					- while the cpu sleeps no segment must be lit and the button
+					  pins must be inputs
+					- the cpu must sleep until a button is pressed and the display
+					  must be multiplexed again afterwards
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+
+#ifndef POWER_MANAGER
+#error "build with -DPOWER_MANAGER"
+#endif
+
+#define PRESS_DELAY		F_CPU				// button is pressed after 1 s
+
+static uint64_t	sleep_start;
+static uint8_t	lit_while_sleeping, pins_driven;
+static uint16_t	anode_writes;
+
+
+#ifndef MUX_TIMER1
+ISR(TIMER0_COMPB_vect)
+{
+	sei();
+	ProtoCounter::update();
+}
+#endif
+
+
+static void slowWrites(uint8_t addr, uint8_t, uint8_t)
+// set_sleep_mode() and sleep_enable() take longer than a mux cycle
+{
+	if (addr == 0x35) {					// MCUCR
+		host_run_cycles(20000);
+	}
+	if (addr == 0x18) {					// PORTB
+		anode_writes++;
+	}
+}
+
+
+static void sleeping(void)
+// called for every cycle of power-down sleep
+{
+	if ((PORTD.value & 0x7F) != 0x7F) { lit_while_sleeping = 1; }
+	if (DDRB.value & BTN_MASK) { pins_driven = 1; }
+	if (host_cycles - sleep_start >= PRESS_DELAY) {
+		host_pin_input_b &= ~BUTTON1;	// press button 1
+	}
+	if (host_cycles - sleep_start >= 3 * PRESS_DELAY) {
+		printf("the button press did not wake the cpu\n");
+		exit(1);
+	}
+}
+
+
+int main(void)
+{
+	host_reset();
+	TCCR0A = (1<<WGM01)|(1<<WGM00);
+	TCCR0B = (1<<CS01)|(1<<CS00);
+	sei();
+	ProtoCounter::init();
+#ifndef MUX_TIMER1
+	TIMSK |= (1<<OCIE0B);
+#endif
+	ProtoCounter::writeInt(888);
+	host_run_cycles(F_CPU / 10);
+
+	host_write_hook = slowWrites;
+	host_sleep_hook = sleeping;
+	sleep_start = host_cycles;
+	ProtoCounter::powerDown();
+	host_sleep_hook = 0;
+
+	CHECK(host_cycles - sleep_start >= PRESS_DELAY);	// no early wake-up
+	CHECK(!lit_while_sleeping);
+	CHECK(!pins_driven);
+
+	host_pin_input_b |= BUTTON1;		// release
+	anode_writes = 0;
+	host_run_cycles(F_CPU / 10);
+	CHECK(anode_writes > 40);			// display is multiplexed again
+	CHECK(ProtoCounter::isDisplayOn());
+	return (TEST_RESULT());
+}
@@ -0,0 +1,122 @@
+/*
+ * test_rate.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the event rate (RATE_BINS)
+					- random events are added between update cycles, the
+					  reference keeps the count of every completed bin
+					- getRate() must equal the events of the last window bins
+					  (or of all completed bins after startup) scaled by
+					  seconds * TICK_FREQ / (bins * RATE_BIN_TIME), rounded
+					  down and computed with 64 bits
+					- periods and windows are chosen so that the window also
+					  does not divide the period, with up to 65535 events per
+					  bin (rates that do not fit into 32 bits are not checked)
+					- setRateWindow() at random times, invalid windows are
+					  ignored
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+
+#ifndef RATE_BINS
+#error "build with -DRATE_BINS=<bins>"
+#endif
+
+#define MAX_BINS	2000
+
+static uint16_t	bin[MAX_BINS];				// events of every completed bin
+static uint16_t	completed;					// number of completed bins
+static uint16_t	events;						// events of the current bin
+static uint8_t	window = RATE_WINDOW;
+
+
+static uint32_t random32(void)
+// xorshift, the same sequence on every host
+{
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (x);
+}
+
+
+static uint64_t expectedRate(uint16_t seconds)
+{
+	uint64_t sum = 0;
+	uint16_t bins, i;
+
+	bins = (completed < window) ? completed : window;
+	if (bins == 0) { return (0); }
+	for (i = completed - bins; i < completed; i++) { sum += bin[i]; }
+	return (sum * seconds * TICK_FREQ / ((uint64_t)bins * RATE_BIN_TIME));
+}
+
+
+int main(void)
+{
+	static const uint16_t period[] = { 1, 7, 60, 61, 3600, 65535 };
+	uint64_t rate;
+	uint32_t cycles = 0;
+	uint16_t n;
+	uint8_t i, w;
+
+	host_reset();
+	ProtoCounter::init();
+
+	while (completed < MAX_BINS) {
+		// events: none, a few or bursts (up to the limit of a bin)
+		switch (random32() % 4) {
+		case 0:	n = 0;											break;
+		case 1:	n = random32() % 3;								break;
+		case 2:	n = random32() % 100;							break;
+		default: n = (completed & 64) ? random32() % 2000 : 0;	break;
+		}
+		if ((uint32_t)events + n > 0xFFFF) { n = 0; }
+		ProtoCounter::addRateEvents(n);
+		events += n;
+
+		ProtoCounter::update();
+		cycles++;
+		if (cycles % RATE_BIN_TIME == 0) {		// bin completed
+			bin[completed++] = events;
+			events = 0;
+		}
+
+		if (random32() % (RATE_BIN_TIME * 3) == 0) {	// change the window
+			w = random32() % (RATE_BINS + 2);
+			ProtoCounter::setRateWindow(w);
+			if ((w >= 1) && (w <= RATE_BINS)) { window = w; }
+		}
+		if ((cycles % 97 == 0) || (cycles % RATE_BIN_TIME == 0)) {
+			for (i = 0; i < sizeof(period) / sizeof(period[0]); i++) {
+				rate = expectedRate(period[i]);
+				if (rate <= 0xFFFFFFFFUL) {		// larger rates do not fit into the result
+					CHECK(ProtoCounter::getRate(period[i]) == rate);
+				}
+			}
+		}
+	}
+	return (TEST_RESULT());
+}
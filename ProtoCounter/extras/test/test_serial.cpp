@@ -0,0 +1,138 @@
+/*
+ * test_serial.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the serial frames (SERIAL_BAUD)
+					- frames queued by sendFrame() arrive complete and with a
+					  correct checksum
+					- commands are executed by pollCommand(), other frame types
+					  are returned, frames with a bad checksum are dropped
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+#include "sh_reg_chain.h"
+
+#ifndef SERIAL_BAUD
+#error "build with -DSERIAL_BAUD=<baud rate> -DSWAP_PINS_PD01_FOR_PB01"
+#endif
+
+static uint8_t	tx[512];				// bytes sent by the library
+static int		tx_count;
+
+
+ISR(TIMER0_COMPB_vect)
+{
+	sei();
+	ProtoCounter::update();
+}
+
+
+static void transmitted(uint8_t data)
+{
+	if (tx_count < (int)sizeof(tx)) { tx[tx_count] = data; }
+	tx_count++;
+}
+
+
+static void receiveFrame(uint8_t type, const uint8_t* payload, uint8_t len, uint8_t corrupt)
+// send a frame to the library, corrupt != 0 falsifies the checksum
+{
+	uint8_t sum = type + len, i;
+
+	host_uart_receive(SERIAL_FRAME_START);
+	host_uart_receive(type);
+	host_uart_receive(len);
+	for (i = 0; i < len; i++) {
+		host_uart_receive(payload[i]);
+		sum += payload[i];
+	}
+	host_uart_receive(sum + corrupt);
+}
+
+
+int main(void)
+{
+	static const uint8_t minus_199[] = { 0x39, 0xFF };		// int16, little endian
+	static const uint8_t app_data[] = { 0x12, 0x34 };
+	static const uint8_t patterns[] = { 0x3F, 0x06, 0x5B };	// "210"
+	static const uint8_t top_bit[] = { 0x80 };				// shorter than the register
+	int32_t		value = -123456;
+	uint8_t		payload[SERIAL_MAX_PAYLOAD], len = 0, type = 0, sum;
+	int			frames = 0, i, k;
+
+	host_reset();
+	TCCR0A = (1<<WGM01)|(1<<WGM00);
+	TCCR0B = (1<<CS01)|(1<<CS00);
+	sei();
+	ProtoCounter::init();
+	host_uart_tx_hook = transmitted;
+
+	// transmit: every accepted frame arrives complete
+	for (k = 0; k < 20; k++) {
+		frames += ProtoCounter::sendFrame(MSG_COUNTER, &value, 4);
+	}
+	host_run_cycles(200000);
+	CHECK(frames >= (SERIAL_TX_BUFFER - 1) / 8);
+	CHECK(tx_count == frames * 8);
+	for (k = 0; (k < frames) && (k * 8 < (int)sizeof(tx)); k++) {
+		CHECK(tx[k * 8] == SERIAL_FRAME_START);
+		CHECK(tx[k * 8 + 1] == MSG_COUNTER);
+		CHECK(tx[k * 8 + 2] == 4);
+		CHECK(memcmp(&tx[k * 8 + 3], &value, 4) == 0);
+		sum = 0;
+		for (i = 1; i < 7; i++) { sum += tx[k * 8 + i]; }
+		CHECK(tx[k * 8 + 7] == sum);
+	}
+
+	// receive: CMD_WRITE_LONG is executed, a corrupt frame is dropped and
+	// an application frame is returned
+	receiveFrame(CMD_WRITE_LONG, minus_199, 2, 0);
+	receiveFrame(0x40, app_data, 2, 1);
+	receiveFrame(0x41, app_data, 2, 0);
+	for (k = 0; (k < 1000) && !type; k++) {
+		host_run_cycles(1000);
+		type = ProtoCounter::pollCommand(payload, &len);
+	}
+	CHECK(type == 0x41);
+	CHECK(len == 2);
+	CHECK(memcmp(payload, app_data, 2) == 0);
+	CHECK(strcmp(displayText(), "-k1") == 0);		// -199 auto-ranged
+
+	// CMD_SET_DISPLAY writes the patterns, rightmost digit first
+	receiveFrame(CMD_SET_DISPLAY, patterns, 3, 0);
+	host_run_cycles(100000);
+	CHECK(ProtoCounter::pollCommand(payload) == 0);
+	CHECK(ProtoCounter::getDisplay(0) == 0x3F);
+	CHECK(ProtoCounter::getDisplay(1) == 0x06);
+	CHECK(ProtoCounter::getDisplay(2) == 0x5B);
+
+	// CMD_WRITE_SH_REG zero extends a short payload
+	host_write_hook = chainModel;
+	receiveFrame(CMD_WRITE_SH_REG, top_bit, 1, 0);
+	host_run_cycles(100000);
+	CHECK(ProtoCounter::pollCommand(payload) == 0);
+	for (k = 0; k < 3 * SH_REG_INTERVAL; k++) { ProtoCounter::update(); }
+	CHECK(chain_outputs == 0x80);
+	return (TEST_RESULT());
+}
@@ -0,0 +1,62 @@
+/*
+ * test_shift_register.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the shift register transfer
+					- models a 74HC595 output chain and a 74HC165 input chain of
+					  SH_REG_OUT_BITCOUNT and SH_REG_IN_BITCOUNT bits on the pins
+					- writes and reads several patterns through update() and
+					  compares the chain contents with the expected values
+
+					Build once with and once without SH_REG_USI: both transfer
+					modes must give the same results (see "run_tests.sh").
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+#include "sh_reg_chain.h"
+
+#if (SH_REG_OUT_BITCOUNT == 0) || (SH_REG_IN_BITCOUNT == 0)
+#error "the shift register test needs input and output bits"
+#endif
+
+
+int main(void)
+{
+	static const uint32_t pattern[] = { 0x00000000UL, 0xFFFFFFFFUL, 0xA5C3E1F7UL,
+										0x12345678UL, 0x80000001UL, 0x55AA55AAUL };
+	uint8_t i, j;
+
+	host_reset();
+	ProtoCounter::init();
+	host_write_hook = chainModel;
+
+	for (i = 0; i < sizeof(pattern) / sizeof(pattern[0]); i++) {
+		chain_inputs = ~pattern[i] & CHAIN_IN_MASK;
+		ProtoCounter::writeShiftRegister((sr_out_data_t)pattern[i]);
+		for (j = 0; j < 3 * SH_REG_INTERVAL; j++) { ProtoCounter::update(); }
+		CHECK(chain_outputs == (pattern[i] & CHAIN_OUT_MASK));
+		CHECK((uint32_t)ProtoCounter::readShiftRegister() == chain_inputs);
+	}
+	return (TEST_RESULT());
+}
@@ -0,0 +1,119 @@
+/*
+ * test_timers.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host test of the software timers (SOFT_TIMERS)
+					- a timer started with delay d expires in the d-th update()
+					  cycle after startTimer(), also for delays longer than one
+					  revolution of the wheel and at any wheel position
+					- a periodic timer then expires every "period" update cycles,
+					  a one-shot timer stops
+					- a stopped or restarted timer does not expire at the old time
+					- a callback is called once per expiry and may stop a timer
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+
+**********************************************************************************/
+
+
+#include <avr/io.h>
+#include "test.h"
+
+#if !defined(SOFT_TIMERS) || (SOFT_TIMERS < 4)
+#error "build with -DSOFT_TIMERS=4 (or more)"
+#endif
+
+static uint8_t	calls;					// number of callback0() calls
+
+
+static void callback0(void)
+{
+	calls++;
+}
+
+
+static void callback1(void)
+{
+	ProtoCounter::stopTimer(3);
+}
+
+
+static uint8_t expiresAt(uint16_t delay, uint16_t period, uint16_t n)
+// return 1 if a timer started with (delay, period) before the first
+// update() cycle expires in cycle n
+{
+	if (n < delay) { return (0); }
+	if (n == delay) { return (1); }
+	return (period && ((n - delay) % period == 0));
+}
+
+
+int main(void)
+{
+	static const uint16_t delay[]  = { 1, 6, 4, 9 };
+	static const uint16_t period[] = { 0, 0, 3, 7 };
+	uint16_t	n;
+	uint8_t		id, start;
+
+	host_reset();
+	ProtoCounter::init();
+
+	// one-shot and periodic expiry times, starting at every wheel position
+	for (start = 0; start < TIMER_WHEEL_SLOTS; start++) {
+		for (id = 0; id < 4; id++) {
+			ProtoCounter::startTimer(id, delay[id], period[id]);
+		}
+		for (n = 1; n <= 100; n++) {
+			ProtoCounter::update();
+			for (id = 0; id < 4; id++) {
+				CHECK(ProtoCounter::timerExpired(id) == expiresAt(delay[id], period[id], n));
+			}
+		}
+		CHECK(!ProtoCounter::timerRunning(0) && !ProtoCounter::timerRunning(1));
+		CHECK(ProtoCounter::timerRunning(2) && ProtoCounter::timerRunning(3));
+		for (id = 0; id < 4; id++) { ProtoCounter::stopTimer(id); }
+		ProtoCounter::update();					// next wheel position
+	}
+
+	// stop and restart: only the restarted time counts
+	ProtoCounter::startTimer(0, 5);
+	ProtoCounter::startTimer(1, 5);
+	for (n = 1; n <= 20; n++) {
+		if (n == 3) {
+			ProtoCounter::stopTimer(0);
+			ProtoCounter::startTimer(1, 10);	// 2 cycles done, expires in 2 + 10
+		}
+		ProtoCounter::update();
+		CHECK(!ProtoCounter::timerExpired(0));
+		CHECK(ProtoCounter::timerExpired(1) == (n == 12));
+	}
+
+	// callbacks: once per expiry, timer 1 stops timer 3 before it expires
+	calls = 0;
+	ProtoCounter::startTimer(0, 2, 2, callback0);
+	ProtoCounter::startTimer(1, 5, 0, callback1);
+	ProtoCounter::startTimer(3, 9);
+	for (n = 1; n <= 20; n++) {
+		ProtoCounter::update();
+		CHECK(calls == n / 2);
+	}
+	CHECK(!ProtoCounter::timerRunning(3));
+	CHECK(!ProtoCounter::timerExpired(3));
+	return (TEST_RESULT());
+}
@@ -0,0 +1,42 @@
+/*
+ * Arduino.h
+ *
+ * Host replacement for the parts of the Arduino core (ATTinyCore pin
+ * numbering) that are used by the ProtoCounter library and its examples.
+ * Time is simulated: millis() and micros() are derived from host_cycles and
+ * delay() advances the simulated time while interrupts are dispatched.
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#ifndef ARDUINO
+#define ARDUINO		10600
+#endif
+
+#define HIGH			1
+#define LOW				0
+#define INPUT			0
+#define OUTPUT			1
+#define INPUT_PULLUP	2
+
+typedef uint8_t		byte;
+typedef bool		boolean;
+
+void			pinMode(uint8_t pin, uint8_t mode);
+void			digitalWrite(uint8_t pin, uint8_t val);
+int				digitalRead(uint8_t pin);
+unsigned long	millis();
+unsigned long	micros();
+void			delay(unsigned long ms);
+void			delayMicroseconds(unsigned int us);
+
+void setup();
+void loop();
+
+#endif /* HOST_ARDUINO_H_ */
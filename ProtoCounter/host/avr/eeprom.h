@@ -0,0 +1,34 @@
+/*
+ * avr/eeprom.h
+ *
+ * Host replacement for <avr/eeprom.h>
+ * The EEPROM is accessed through the simulated EEAR, EEDR and EECR registers
+ * (see "host_io.cpp"). Busy waiting advances the simulated time.
+ */
+
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+
+#include <avr/io.h>
+
+#define eeprom_is_ready()		((EECR & (1<<EEPE)) == 0)
+#define eeprom_busy_wait()		do { while (!eeprom_is_ready()) { host_run_cycles(1); } } while (0)
+
+static inline uint8_t eeprom_read_byte(const uint8_t* addr)
+{
+	eeprom_busy_wait();
+	EEAR = (uint8_t)(uintptr_t)addr;
+	EECR |= (1<<EERE);
+	return (EEDR);
+}
+
+static inline void eeprom_write_byte(uint8_t* addr, uint8_t val)
+{
+	eeprom_busy_wait();
+	EEAR = (uint8_t)(uintptr_t)addr;
+	EEDR = val;
+	EECR |= (1<<EEMPE);
+	EECR |= (1<<EEPE);
+}
+
+#endif /* HOST_AVR_EEPROM_H_ */
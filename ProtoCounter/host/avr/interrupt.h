@@ -0,0 +1,24 @@
+/*
+ * avr/interrupt.h
+ *
+ * Host replacement for <avr/interrupt.h>
+ * An interrupt routine becomes a plain C function named after its vector.
+ * The global interrupt flag is the I bit of the simulated SREG.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define sei()					(SREG |=  (1<<SREG_I))
+#define cli()					(SREG &= ~(1<<SREG_I))
+#define reti()					return
+
+#define ISR(vector, ...)		extern "C" void vector(void); \
+								void vector(void)
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
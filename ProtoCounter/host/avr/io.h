@@ -0,0 +1,354 @@
+/*
+ * avr/io.h
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Host replacement for <avr/io.h>
+					The i/o registers of the ATtiny2313/4313 are simulated as plain
+					memory. Reading and writing a register can be intercepted by
+					hooks (see "host_io.cpp") in order to model external hardware
+					like push buttons or shift registers.
+					Registers are indexed by their i/o address (0x00..0x3F).
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <inttypes.h>
+
+#ifndef PROTOCOUNTER_HOST
+#define PROTOCOUNTER_HOST
+#endif
+
+#ifndef F_CPU
+#define F_CPU	8000000UL
+#endif
+
+
+/**************
+ * data types *
+ **************/
+
+class host_reg8
+// simulated 8 bit i/o register
+{
+public:
+	uint8_t value;								// raw register content
+	operator uint8_t() const;					// read (calls read hook)
+	host_reg8& operator=(int val);				// write (calls write hook)
+	host_reg8& operator=(const host_reg8& reg)	{ return (*this = (uint8_t)reg); }
+	host_reg8& operator|=(int val)				{ return (*this = (*this | val)); }
+	host_reg8& operator&=(int val)				{ return (*this = (*this & val)); }
+	host_reg8& operator^=(int val)				{ return (*this = (*this ^ val)); }
+};
+
+class host_reg16
+// simulated 16 bit i/o register (low byte at addr, high byte at addr+1)
+{
+public:
+	explicit host_reg16(uint8_t addr) : addr(addr) {}
+	operator uint16_t() const;
+	host_reg16& operator=(long val);
+	host_reg16& operator|=(long val)			{ return (*this = (*this | val)); }
+	host_reg16& operator&=(long val)			{ return (*this = (*this & val)); }
+private:
+	uint8_t addr;
+};
+
+extern host_reg8 host_io[0x40];
+
+
+/*************
+ * registers *
+ *************/
+
+#define _SFR_IO8(addr)		(host_io[addr])
+#define _SFR_IO16(addr)		(host_reg16(addr))
+#define _BV(bit)			(1 << (bit))
+
+#define SREG		_SFR_IO8(0x3F)
+#define SPL			_SFR_IO8(0x3D)
+#define OCR0B		_SFR_IO8(0x3C)
+#define GIMSK		_SFR_IO8(0x3B)
+#define EIFR		_SFR_IO8(0x3A)
+#define TIMSK		_SFR_IO8(0x39)
+#define TIFR		_SFR_IO8(0x38)
+#define SPMCSR		_SFR_IO8(0x37)
+#define OCR0A		_SFR_IO8(0x36)
+#define MCUCR		_SFR_IO8(0x35)
+#define MCUSR		_SFR_IO8(0x34)
+#define TCCR0B		_SFR_IO8(0x33)
+#define TCNT0		_SFR_IO8(0x32)
+#define OSCCAL		_SFR_IO8(0x31)
+#define TCCR0A		_SFR_IO8(0x30)
+#define TCCR1A		_SFR_IO8(0x2F)
+#define TCCR1B		_SFR_IO8(0x2E)
+#define TCNT1		_SFR_IO16(0x2C)
+#define TCNT1L		_SFR_IO8(0x2C)
+#define TCNT1H		_SFR_IO8(0x2D)
+#define OCR1A		_SFR_IO16(0x2A)
+#define OCR1AL		_SFR_IO8(0x2A)
+#define OCR1AH		_SFR_IO8(0x2B)
+#define OCR1B		_SFR_IO16(0x28)
+#define OCR1BL		_SFR_IO8(0x28)
+#define OCR1BH		_SFR_IO8(0x29)
+#define CLKPR		_SFR_IO8(0x26)
+#define ICR1		_SFR_IO16(0x24)
+#define ICR1L		_SFR_IO8(0x24)
+#define ICR1H		_SFR_IO8(0x25)
+#define GTCCR		_SFR_IO8(0x23)
+#define TCCR1C		_SFR_IO8(0x22)
+#define WDTCSR		_SFR_IO8(0x21)
+#define PCMSK		_SFR_IO8(0x20)
+#define EEAR		_SFR_IO8(0x1E)
+#define EEDR		_SFR_IO8(0x1D)
+#define EECR		_SFR_IO8(0x1C)
+#define PORTA		_SFR_IO8(0x1B)
+#define DDRA		_SFR_IO8(0x1A)
+#define PINA		_SFR_IO8(0x19)
+#define PORTB		_SFR_IO8(0x18)
+#define DDRB		_SFR_IO8(0x17)
+#define PINB		_SFR_IO8(0x16)
+#define GPIOR2		_SFR_IO8(0x15)
+#define GPIOR1		_SFR_IO8(0x14)
+#define GPIOR0		_SFR_IO8(0x13)
+#define PORTD		_SFR_IO8(0x12)
+#define DDRD		_SFR_IO8(0x11)
+#define PIND		_SFR_IO8(0x10)
+#define USIDR		_SFR_IO8(0x0F)
+#define USISR		_SFR_IO8(0x0E)
+#define USICR		_SFR_IO8(0x0D)
+#define UDR			_SFR_IO8(0x0C)
+#define UCSRA		_SFR_IO8(0x0B)
+#define UCSRB		_SFR_IO8(0x0A)
+#define UBRRL		_SFR_IO8(0x09)
+#define ACSR		_SFR_IO8(0x08)
+#define UCSRC		_SFR_IO8(0x03)
+#define UBRRH		_SFR_IO8(0x02)
+#define DIDR		_SFR_IO8(0x01)
+
+#define RAMEND		0xDF
+#define E2END		0x7F
+
+
+/********
+ * bits *
+ ********/
+
+// SREG
+#define SREG_I		7
+
+// GIMSK, EIFR
+#define INT1		7
+#define INT0		6
+#define PCIE		5
+#define INTF1		7
+#define INTF0		6
+#define PCIF		5
+
+// TIMSK, TIFR
+#define TOIE1		7
+#define OCIE1A		6
+#define OCIE1B		5
+#define ICIE1		3
+#define OCIE0B		2
+#define TOIE0		1
+#define OCIE0A		0
+#define TOV1		7
+#define OCF1A		6
+#define OCF1B		5
+#define ICF1		3
+#define OCF0B		2
+#define TOV0		1
+#define OCF0A		0
+
+// MCUCR
+#define PUD			7
+#define SM1			6
+#define SE			5
+#define SM0			4
+#define ISC11		3
+#define ISC10		2
+#define ISC01		1
+#define ISC00		0
+
+// TCCR0A, TCCR0B
+#define COM0A1		7
+#define COM0A0		6
+#define COM0B1		5
+#define COM0B0		4
+#define WGM01		1
+#define WGM00		0
+#define FOC0A		7
+#define FOC0B		6
+#define WGM02		3
+#define CS02		2
+#define CS01		1
+#define CS00		0
+
+// TCCR1A, TCCR1B
+#define COM1A1		7
+#define COM1A0		6
+#define COM1B1		5
+#define COM1B0		4
+#define WGM11		1
+#define WGM10		0
+#define ICNC1		7
+#define ICES1		6
+#define WGM13		4
+#define WGM12		3
+#define CS12		2
+#define CS11		1
+#define CS10		0
+
+// WDTCSR
+#define WDIF		7
+#define WDIE		6
+#define WDP3		5
+#define WDCE		4
+#define WDE			3
+#define WDP2		2
+#define WDP1		1
+#define WDP0		0
+
+// EECR
+#define EEPM1		5
+#define EEPM0		4
+#define EERIE		3
+#define EEMPE		2
+#define EEPE		1
+#define EERE		0
+
+// USICR, USISR
+#define USISIE		7
+#define USIOIE		6
+#define USIWM1		5
+#define USIWM0		4
+#define USICS1		3
+#define USICS0		2
+#define USICLK		1
+#define USITC		0
+#define USISIF		7
+#define USIOIF		6
+#define USIPF		5
+#define USIDC		4
+#define USICNT3		3
+#define USICNT2		2
+#define USICNT1		1
+#define USICNT0		0
+
+// UCSRA, UCSRB, UCSRC
+#define RXC			7
+#define TXC			6
+#define UDRE		5
+#define FE			4
+#define DOR			3
+#define UPE			2
+#define U2X			1
+#define MPCM		0
+#define RXCIE		7
+#define TXCIE		6
+#define UDRIE		5
+#define RXEN		4
+#define TXEN		3
+#define UCSZ2		2
+#define RXB8		1
+#define TXB8		0
+#define UMSEL		6
+#define UPM1		5
+#define UPM0		4
+#define USBS		3
+#define UCSZ1		2
+#define UCSZ0		1
+#define UCPOL		0
+
+// ACSR, DIDR
+#define ACD			7
+#define ACBG		6
+#define ACO			5
+#define ACI			4
+#define ACIE		3
+#define ACIC		2
+#define ACIS1		1
+#define ACIS0		0
+#define AIN1D		1
+#define AIN0D		0
+
+// port pins
+#define PA0			0
+#define PA1			1
+#define PA2			2
+#define PB0			0
+#define PB1			1
+#define PB2			2
+#define PB3			3
+#define PB4			4
+#define PB5			5
+#define PB6			6
+#define PB7			7
+#define PD0			0
+#define PD1			1
+#define PD2			2
+#define PD3			3
+#define PD4			4
+#define PD5			5
+#define PD6			6
+
+
+/*******************
+ * host simulation *
+ *******************/
+
+// Hooks are called on every access to a simulated register.
+// The read hook may replace the value returned to the firmware.
+typedef void	(*host_write_hook_t)(uint8_t addr, uint8_t old_val, uint8_t new_val);
+typedef uint8_t	(*host_read_hook_t)(uint8_t addr, uint8_t val);
+
+extern host_write_hook_t	host_write_hook;
+extern host_read_hook_t		host_read_hook;
+
+// Logic level applied from outside to pins configured as inputs.
+// A pin that is not driven externally reads as high (pull-up).
+extern uint8_t host_pin_input_a;
+extern uint8_t host_pin_input_b;
+extern uint8_t host_pin_input_d;
+
+extern uint64_t host_cycles;				// number of simulated cpu cycles
+extern uint8_t host_eeprom[E2END + 1];		// EEPROM content (0xFF = erased)
+
+// Called on every simulated cycle while the cpu is in power-down mode
+// (timers stopped). It may change the pin inputs to wake the cpu by a
+// pin change. Without a hook the cpu wakes up immediately.
+typedef void	(*host_sleep_hook_t)(void);
+extern host_sleep_hook_t	host_sleep_hook;
+
+// Called for every byte that has been transmitted by the USART.
+typedef void	(*host_uart_hook_t)(uint8_t data);
+extern host_uart_hook_t		host_uart_tx_hook;
+
+void host_reset();							// reset all registers and hooks
+void host_run_cycles(uint32_t cycles);		// advance timers and dispatch interrupts
+void host_sleep();							// sleep until an interrupt has been served
+uint8_t host_uart_receive(uint8_t data);	// queue a byte for the USART receiver (0 = queue full)
+void host_comparator_event();				// analog comparator output toggles (ACI, input capture)
+
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,23 @@
+/*
+ * avr/pgmspace.h
+ *
+ * Host replacement for <avr/pgmspace.h>
+ * On the host there is only one address space, so flash data lives in ram.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <inttypes.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)					(s)
+#define pgm_read_byte(addr)		(*(const uint8_t*)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t*)(addr))
+#define pgm_read_dword(addr)	(*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr)		(*(void* const*)(addr))
+#define strlen_P(s)				strlen(s)
+#define memcpy_P(d, s, n)		memcpy((d), (s), (n))
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
@@ -0,0 +1,25 @@
+/*
+ * avr/sleep.h
+ *
+ * Host replacement for <avr/sleep.h>
+ * The sleep mode is kept in the SM bits of the simulated MCUCR.
+ * sleep_cpu() advances the simulated time until an interrupt has been
+ * served (see host_sleep() in "host_io.cpp").
+ */
+
+#ifndef HOST_AVR_SLEEP_H_
+#define HOST_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE			0
+#define SLEEP_MODE_PWR_DOWN		(1<<SM0)
+#define SLEEP_MODE_STANDBY		(1<<SM1)
+
+#define set_sleep_mode(mode)	(MCUCR = (MCUCR & ~((1<<SM1)|(1<<SM0))) | (mode))
+#define sleep_enable()			(MCUCR |=  (1<<SE))
+#define sleep_disable()			(MCUCR &= ~(1<<SE))
+#define sleep_cpu()				host_sleep()
+#define sleep_mode()			do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+#endif /* HOST_AVR_SLEEP_H_ */
@@ -0,0 +1,677 @@
+/*
+ * host_io.cpp
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Register simulation for building the ProtoCounter library on a
+					host computer (see "avr/io.h" in this folder)
+					- i/o registers as plain memory with read/write hooks
+					- port pins with external input levels
+					- timer0 and timer1 with interrupt flags
+					- analog comparator events with timer1 input capture
+					- USI three-wire mode clocked by software (USITC/USICLK)
+					- USART with transmit/receive timing derived from UBRR
+					- EEPROM with write time (content survives host_reset())
+					- interrupt dispatching in vector priority order, nested
+					  when an interrupt routine enables interrupts
+					- the Arduino functions used by the examples
+
+License:			see "license.md"
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+/************
+ * includes *
+ ************/
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "Arduino.h"
+
+
+/**********
+ * macros *
+ **********/
+
+#define IO_ADDR(reg)	((uint8_t)(&(reg) - host_io))	// i/o address of a register
+
+
+/*******************
+ * interrupt table *
+ *******************/
+
+// Interrupt routines are weak symbols: a vector without an ISR is null.
+#define HOST_VECTOR(vect)	extern "C" void vect(void) __attribute__((weak));
+HOST_VECTOR(TIMER1_COMPA_vect)
+HOST_VECTOR(TIMER1_OVF_vect)
+HOST_VECTOR(TIMER0_OVF_vect)
+HOST_VECTOR(USART_RX_vect)
+HOST_VECTOR(USART_UDRE_vect)
+HOST_VECTOR(USART_TX_vect)
+HOST_VECTOR(ANA_COMP_vect)
+HOST_VECTOR(PCINT_vect)
+HOST_VECTOR(TIMER1_COMPB_vect)
+HOST_VECTOR(TIMER0_COMPA_vect)
+HOST_VECTOR(TIMER0_COMPB_vect)
+HOST_VECTOR(EE_READY_vect)
+
+struct host_irq_t {
+	uint8_t	flag_addr;			// register holding the interrupt flag
+	uint8_t	flag_bit;
+	uint8_t	enable_addr;		// register holding the interrupt enable bit
+	uint8_t	enable_bit;
+	uint8_t	mode;				// IRQ_EDGE, IRQ_LEVEL or IRQ_LEVEL_LOW
+	void	(*vector)(void);
+};
+
+#define IRQ_EDGE		0		// flag is cleared by entering the routine
+#define IRQ_LEVEL		1		// interrupt while the flag is set
+#define IRQ_LEVEL_LOW	2		// interrupt while the flag is cleared
+
+// sorted by priority (lowest vector number first)
+static const host_irq_t irq_table[] = {
+	{ 0x38, OCF1A, 0x39, OCIE1A, IRQ_EDGE,      TIMER1_COMPA_vect },
+	{ 0x38, TOV1,  0x39, TOIE1,  IRQ_EDGE,      TIMER1_OVF_vect },
+	{ 0x38, TOV0,  0x39, TOIE0,  IRQ_EDGE,      TIMER0_OVF_vect },
+	{ 0x0B, RXC,   0x0A, RXCIE,  IRQ_LEVEL,     USART_RX_vect },
+	{ 0x0B, UDRE,  0x0A, UDRIE,  IRQ_LEVEL,     USART_UDRE_vect },
+	{ 0x0B, TXC,   0x0A, TXCIE,  IRQ_EDGE,      USART_TX_vect },
+	{ 0x08, ACI,   0x08, ACIE,   IRQ_EDGE,      ANA_COMP_vect },
+	{ 0x3A, PCIF,  0x3B, PCIE,   IRQ_EDGE,      PCINT_vect },
+	{ 0x38, OCF1B, 0x39, OCIE1B, IRQ_EDGE,      TIMER1_COMPB_vect },
+	{ 0x38, OCF0A, 0x39, OCIE0A, IRQ_EDGE,      TIMER0_COMPA_vect },
+	{ 0x38, OCF0B, 0x39, OCIE0B, IRQ_EDGE,      TIMER0_COMPB_vect },
+	{ 0x1C, EEPE,  0x1C, EERIE,  IRQ_LEVEL_LOW, EE_READY_vect },
+};
+
+
+/********************
+ * global variables *
+ ********************/
+
+host_reg8			host_io[0x40];
+host_write_hook_t	host_write_hook;
+host_read_hook_t	host_read_hook;
+host_sleep_hook_t	host_sleep_hook;
+host_uart_hook_t	host_uart_tx_hook;
+uint8_t				host_pin_input_a = 0xFF;
+uint8_t				host_pin_input_b = 0xFF;
+uint8_t				host_pin_input_d = 0xFF;
+uint64_t			host_cycles;
+
+static uint16_t		t0_prescaler;		// prescaler counters
+static uint16_t		t1_prescaler;
+static uint8_t		pcint_level;		// last level of port B (pin change detection)
+static uint32_t		irq_count;			// number of interrupt routines served
+
+#define UART_RX_FIFO	64					// bytes waiting to be received
+static uint8_t		uart_rx_fifo[UART_RX_FIFO];
+static uint8_t		uart_rx_head, uart_rx_tail;
+static uint8_t		uart_rx_data;		// UDR (receive side)
+static uint32_t		uart_rx_timer;		// cycles until the next byte arrives
+static uint8_t		uart_tx_buffer;		// UDR (transmit side)
+static uint8_t		uart_tx_shift;		// byte being transmitted
+static uint32_t		uart_tx_timer;		// cycles until the transmission ends (0 = idle)
+
+#define EEPROM_WRITE_CYCLES	((uint32_t)(F_CPU / 1000000UL * 3400))	// erase and write: 3.4 ms
+uint8_t				host_eeprom[E2END + 1];
+static uint32_t		eeprom_timer;		// cycles until the write ends (0 = idle)
+static uint8_t		eeprom_addr;		// address being written
+static uint8_t		eeprom_data;
+static uint64_t		eeprom_mpe_cycle;	// cycle of setting EEMPE
+
+static const uint16_t clock_div[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+
+/*************
+ * registers *
+ *************/
+
+static uint8_t* pin_input(uint8_t addr)
+// external input levels of the port that owns PINx register "addr"
+{
+	if (addr == IO_ADDR(PINA)) { return (&host_pin_input_a); }
+	if (addr == IO_ADDR(PINB)) { return (&host_pin_input_b); }
+	if (addr == IO_ADDR(PIND)) { return (&host_pin_input_d); }
+	return (0);
+}
+
+
+host_reg8::operator uint8_t() const
+{
+	uint8_t addr = (uint8_t)(this - host_io);
+	uint8_t val = value;
+	uint8_t* ext = pin_input(addr);
+
+	if (ext) {								// PINx = PORTx for outputs, external level for inputs
+		uint8_t ddr  = host_io[addr + 1].value;
+		uint8_t port = host_io[addr + 2].value;
+		val = (port & ddr) | (*ext & ~ddr);
+	}
+	else if (addr == IO_ADDR(UDR)) {		// reading UDR clears RXC
+		val = uart_rx_data;
+		UCSRA.value &= ~((1<<RXC)|(1<<DOR));
+	}
+	if (host_read_hook) {
+		val = host_read_hook(addr, val);
+	}
+	return (val);
+}
+
+
+/*******
+ * USI *
+ *******/
+
+static void usi_count()
+// advance 4 bit counter, set overflow flag on wrap around
+{
+	uint8_t cnt = (USISR.value + 1) & 0x0F;
+
+	USISR.value = (USISR.value & 0xF0) | cnt;
+	if (cnt == 0) { USISR.value |= (1<<USIOIF); }
+}
+
+
+static void usi_shift()
+// shift USIDR left, sample DI (PB5) into bit 0
+{
+	uint8_t ddr = DDRB.value;
+	uint8_t di = ((PORTB.value & ddr) | (host_pin_input_b & ~ddr)) & (1<<PB5);
+
+	USIDR.value = (USIDR.value << 1) | (di ? 1 : 0);
+}
+
+
+static uint8_t usi_control(uint8_t val)
+// handle clock strobes written to USICR, returns the value to be stored
+{
+	uint8_t clk_src = val & ((1<<USICS1)|(1<<USICS0)|(1<<USICLK));
+
+	if (val & (1<<USITC)) {						// toggle USCK (PB7)
+		PORTB.value ^= (1<<PB7);
+		if (clk_src == ((1<<USICS1)|(1<<USICLK))) {
+			usi_count();						// counter counts both edges,
+			if (PORTB.value & (1<<PB7)) {		// shift register the positive one
+				usi_shift();
+			}
+		}
+	}
+	else if (clk_src == (1<<USICLK)) {			// software clock strobe
+		usi_shift();
+		usi_count();
+	}
+	return (val & ~((1<<USICLK)|(1<<USITC)));	// strobe bits read as zero
+}
+
+
+/*********
+ * USART *
+ *********/
+
+static uint32_t uart_frame_cycles()
+// duration of a frame (start bit, 8 data bits, stop bit) in cpu cycles
+{
+	uint16_t ubrr = (((uint16_t)UBRRH.value & 0x0F) << 8) | UBRRL.value;
+
+	return ((uint32_t)(ubrr + 1) * ((UCSRA.value & (1<<U2X)) ? 8 : 16) * 10);
+}
+
+
+static void uart_transmit(uint8_t data)
+// byte written to UDR: start transmission or wait in the buffer
+{
+	if ((UCSRB.value & (1<<TXEN)) == 0) { return; }
+	if (uart_tx_timer == 0) {				// shift register empty
+		uart_tx_shift = data;
+		uart_tx_timer = uart_frame_cycles();
+	}
+	else {
+		uart_tx_buffer = data;
+		UCSRA.value &= ~(1<<UDRE);
+	}
+}
+
+
+static void uart_tick()
+{
+	if (uart_tx_timer && (--uart_tx_timer == 0)) {	// transmission complete
+		if (host_uart_tx_hook) {
+			host_uart_tx_hook(uart_tx_shift);
+		}
+		if ((UCSRA.value & (1<<UDRE)) == 0) {		// next byte from buffer
+			uart_tx_shift = uart_tx_buffer;
+			uart_tx_timer = uart_frame_cycles();
+			UCSRA.value |= (1<<UDRE);
+		}
+		else {
+			UCSRA.value |= (1<<TXC);
+		}
+	}
+
+	if ((UCSRB.value & (1<<RXEN)) == 0) {
+		uart_rx_timer = 0;
+	}
+	else if (uart_rx_timer) {
+		if (--uart_rx_timer == 0) {					// byte received
+			if (UCSRA.value & (1<<RXC)) {
+				UCSRA.value |= (1<<DOR);			// data overrun: byte is lost
+			}
+			else {
+				uart_rx_data = uart_rx_fifo[uart_rx_tail];
+				UCSRA.value |= (1<<RXC);
+			}
+			uart_rx_tail = (uart_rx_tail + 1) % UART_RX_FIFO;
+		}
+	}
+	else if (uart_rx_head != uart_rx_tail) {		// start receiving next byte
+		uart_rx_timer = uart_frame_cycles();
+	}
+}
+
+
+uint8_t host_uart_receive(uint8_t data)
+{
+	uint8_t next = (uart_rx_head + 1) % UART_RX_FIFO;
+
+	if (next == uart_rx_tail) { return (0); }
+	uart_rx_fifo[uart_rx_head] = data;
+	uart_rx_head = next;
+	return (1);
+}
+
+
+/*********************
+ * analog comparator *
+ *********************/
+
+void host_comparator_event()
+// The comparator output has changed in the direction selected by the
+// firmware: set the interrupt flag and, if the input capture is connected
+// to the comparator (ACIC), copy timer1 to ICR1.
+{
+	ACSR.value |= (1<<ACI);
+	if (ACSR.value & (1<<ACIC)) {
+		ICR1L.value = TCNT1L.value;
+		ICR1H.value = TCNT1H.value;
+		TIFR.value |= (1<<ICF1);
+	}
+}
+
+
+/**********
+ * EEPROM *
+ **********/
+
+struct host_eeprom_init {
+	host_eeprom_init()	{ memset(host_eeprom, 0xFF, sizeof(host_eeprom)); }	// erased
+};
+static host_eeprom_init eeprom_init;
+
+
+static uint8_t eeprom_control(uint8_t old, uint8_t val)
+// handle a write to EECR, returns the value to be stored
+{
+	uint8_t busy = old & (1<<EEPE);
+
+	if ((val & (1<<EERE)) && !busy) {				// read (ignored while writing)
+		EEDR.value = host_eeprom[EEAR.value & E2END];
+	}
+	if ((val & (1<<EEPE)) && !busy && (old & (1<<EEMPE))) {	// start writing
+		eeprom_addr = EEAR.value & E2END;
+		eeprom_data = EEDR.value;
+		eeprom_timer = EEPROM_WRITE_CYCLES;
+		busy = (1<<EEPE);
+		val &= ~(1<<EEMPE);
+	}
+	if ((val & (1<<EEMPE)) && !(old & (1<<EEMPE))) {
+		eeprom_mpe_cycle = host_cycles;
+	}
+	return ((val & ~((1<<EERE)|(1<<EEPE))) | busy);
+}
+
+
+static void eeprom_tick()
+{
+	if ((EECR.value & (1<<EEMPE)) && (host_cycles - eeprom_mpe_cycle >= 4)) {
+		EECR.value &= ~(1<<EEMPE);					// EEMPE is cleared after 4 cycles
+	}
+	if (eeprom_timer && (--eeprom_timer == 0)) {	// write complete
+		if ((EECR.value & ((1<<EEPM1)|(1<<EEPM0))) == (1<<EEPM0)) {
+			host_eeprom[eeprom_addr] = 0xFF;		// erase only
+		}
+		else if ((EECR.value & ((1<<EEPM1)|(1<<EEPM0))) == (1<<EEPM1)) {
+			host_eeprom[eeprom_addr] &= eeprom_data;	// write only
+		}
+		else {
+			host_eeprom[eeprom_addr] = eeprom_data;
+		}
+		EECR.value &= ~(1<<EEPE);
+	}
+}
+
+
+host_reg8& host_reg8::operator=(int new_val)
+{
+	uint8_t addr = (uint8_t)(this - host_io);
+	uint8_t old = value;
+	uint8_t val = (uint8_t)new_val;
+
+	if ((addr == IO_ADDR(TIFR)) || (addr == IO_ADDR(EIFR))) {
+		val = old & ~val;						// writing a one clears a flag
+	}
+	else if (addr == IO_ADDR(ACSR)) {
+		uint8_t aci = (val & (1<<ACI)) ? 0 : (old & (1<<ACI));	// writing a one clears ACI
+		val = (val & ~((1<<ACO)|(1<<ACI))) | (old & (1<<ACO)) | aci;	// ACO is read-only
+	}
+	else if (addr == IO_ADDR(USISR)) {
+		val = (old & ~val & 0xE0) | (old & (1<<USIDC)) | (val & 0x0F);	// flags: writing a one clears
+	}
+	else if (addr == IO_ADDR(USICR)) {
+		val = usi_control(val);
+	}
+	else if (addr == IO_ADDR(UDR)) {
+		uart_transmit(val);
+	}
+	else if (addr == IO_ADDR(EECR)) {
+		val = eeprom_control(old, val);
+	}
+	else if (addr == IO_ADDR(UCSRA)) {
+		uint8_t txc = (val & (1<<TXC)) ? 0 : (old & (1<<TXC));	// writing a one clears TXC
+		val = (old & ((1<<RXC)|(1<<UDRE)|(1<<FE)|(1<<DOR)|(1<<UPE))) | txc | (val & ((1<<U2X)|(1<<MPCM)));
+	}
+	else if (pin_input(addr)) {
+		host_io[addr + 2].value ^= val;			// writing PINx toggles PORTx
+		val = old;
+	}
+	value = val;
+	if (host_write_hook) {
+		host_write_hook(addr, old, val);
+	}
+	return (*this);
+}
+
+
+host_reg16::operator uint16_t() const
+{
+	return ((uint16_t)host_io[addr] | ((uint16_t)host_io[addr + 1] << 8));
+}
+
+
+host_reg16& host_reg16::operator=(long val)
+{
+	host_io[addr + 1] = (uint8_t)(val >> 8);	// high byte first (as on the real chip)
+	host_io[addr] = (uint8_t)val;
+	return (*this);
+}
+
+
+/***************
+ * pin changes *
+ ***************/
+
+static uint8_t port_b_level()
+// logic level of the port B pins
+{
+	uint8_t ddr = DDRB.value;
+
+	return ((PORTB.value & ddr) | (host_pin_input_b & ~ddr));
+}
+
+
+static void pin_change()
+// set the pin change flag if a pin enabled in PCMSK has changed
+{
+	uint8_t level = port_b_level();
+
+	if ((level ^ pcint_level) & PCMSK.value) {
+		EIFR.value |= (1<<PCIF);
+	}
+	pcint_level = level;
+}
+
+
+/**********
+ * timers *
+ **********/
+
+static void timer0_tick()
+{
+	uint8_t top = 0xFF;
+
+	if ((TCCR0A.value & ((1<<WGM01)|(1<<WGM00))) == (1<<WGM01)) {
+		top = OCR0A.value;						// CTC mode
+	}
+	if (TCNT0.value == top) {
+		TCNT0.value = 0;
+		if (top == 0xFF) { TIFR.value |= (1<<TOV0); }
+	} else {
+		TCNT0.value++;
+	}
+	if (TCNT0.value == OCR0A.value) { TIFR.value |= (1<<OCF0A); }
+	if (TCNT0.value == OCR0B.value) { TIFR.value |= (1<<OCF0B); }
+}
+
+
+static void timer1_tick()
+{
+	uint16_t cnt = (uint16_t)TCNT1L.value | ((uint16_t)TCNT1H.value << 8);
+	uint16_t ocr1a = (uint16_t)OCR1AL.value | ((uint16_t)OCR1AH.value << 8);
+	uint16_t ocr1b = (uint16_t)OCR1BL.value | ((uint16_t)OCR1BH.value << 8);
+	uint16_t top = 0xFFFF;
+
+	if ((TCCR1B.value & ((1<<WGM13)|(1<<WGM12))) == (1<<WGM12)) {
+		top = ocr1a;							// CTC mode
+	}
+	if (cnt == top) {
+		cnt = 0;
+		if (top == 0xFFFF) { TIFR.value |= (1<<TOV1); }
+	} else {
+		cnt++;
+	}
+	if (cnt == ocr1a) { TIFR.value |= (1<<OCF1A); }
+	if (cnt == ocr1b) { TIFR.value |= (1<<OCF1B); }
+	TCNT1L.value = (uint8_t)cnt;
+	TCNT1H.value = (uint8_t)(cnt >> 8);
+}
+
+
+/**************
+ * interrupts *
+ **************/
+
+static void dispatch_interrupts()
+// call the interrupt routine of every pending and enabled interrupt
+// Like on the avr, an interrupt routine that enables interrupts (sei()) is
+// interrupted when it advances the simulated time (e.g. by a hook).
+{
+	uint8_t i;
+
+	for (i = 0; i < sizeof(irq_table) / sizeof(irq_table[0]); i++) {
+		const host_irq_t* irq = &irq_table[i];
+		if ((SREG.value & (1<<SREG_I)) == 0) { return; }
+		uint8_t flag = host_io[irq->flag_addr].value & (1<<irq->flag_bit);
+		if (irq->mode == IRQ_LEVEL_LOW) { flag = !flag; }
+		if (flag && (host_io[irq->enable_addr].value & (1<<irq->enable_bit))) {
+			if (irq->mode == IRQ_EDGE) {
+				host_io[irq->flag_addr].value &= ~(1<<irq->flag_bit);
+			}
+			if (irq->vector) {
+				irq_count++;
+				SREG.value &= ~(1<<SREG_I);		// interrupts are disabled on entry ...
+				irq->vector();
+				SREG.value |= (1<<SREG_I);		// ... and re-enabled by reti
+			}
+		}
+	}
+}
+
+
+void host_reset()
+{
+	uint8_t i;
+
+	for (i = 0; i < 0x40; i++) {
+		host_io[i].value = 0;
+	}
+	host_write_hook = 0;
+	host_read_hook = 0;
+	host_sleep_hook = 0;
+	host_uart_tx_hook = 0;
+	host_pin_input_a = 0xFF;
+	host_pin_input_b = 0xFF;
+	host_pin_input_d = 0xFF;
+	host_cycles = 0;
+	t0_prescaler = 0;
+	t1_prescaler = 0;
+	irq_count = 0;
+	pcint_level = port_b_level();
+	UCSRA.value = (1<<UDRE);
+	UCSRC.value = (1<<UCSZ1)|(1<<UCSZ0);
+	uart_rx_head = 0;
+	uart_rx_tail = 0;
+	uart_rx_timer = 0;
+	uart_tx_timer = 0;
+	eeprom_timer = 0;							// a pending EEPROM write is lost
+}
+
+
+void host_run_cycles(uint32_t cycles)
+{
+	uint16_t div0, div1;
+
+	while (cycles--) {
+		host_cycles++;
+		div0 = clock_div[TCCR0B.value & 0x07];
+		if (div0 && (++t0_prescaler >= div0)) {
+			t0_prescaler = 0;
+			timer0_tick();
+		}
+		div1 = clock_div[TCCR1B.value & 0x07];
+		if (div1 && (++t1_prescaler >= div1)) {
+			t1_prescaler = 0;
+			timer1_tick();
+		}
+		uart_tick();
+		eeprom_tick();
+		pin_change();
+		dispatch_interrupts();
+	}
+	dispatch_interrupts();
+}
+
+
+void host_sleep()
+{
+	uint32_t count = irq_count;
+
+	if ((MCUCR.value & (1<<SE)) == 0) { return; }		// sleep not enabled
+	if ((SREG.value & (1<<SREG_I)) == 0) { return; }	// would sleep forever
+
+	if (MCUCR.value & ((1<<SM1)|(1<<SM0))) {		// power-down or standby: timers stop
+		while (host_sleep_hook && (count == irq_count)) {
+			host_cycles++;
+			host_sleep_hook();
+			pin_change();
+			dispatch_interrupts();
+		}
+	}
+	else {											// idle: timers keep running
+		while (count == irq_count) {
+			host_run_cycles(1);
+		}
+	}
+}
+
+
+/*********************
+ * Arduino functions *
+ *********************/
+
+// ATTinyCore pin numbering: pin -> (port << 4) | bit
+// port 0 = A, 1 = B, 2 = D
+static const uint8_t pin_map[] = {
+	0x20, 0x21, 0x01, 0x00, 0x22, 0x23, 0x24, 0x25, 0x26,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x02
+};
+static const uint8_t port_addr[] = { 0x1B, 0x18, 0x12 };	// PORTA, PORTB, PORTD
+
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin >= sizeof(pin_map)) { return; }
+	uint8_t port = port_addr[pin_map[pin] >> 4];
+	uint8_t bit = (1 << (pin_map[pin] & 0x07));
+
+	if (mode == OUTPUT) {
+		host_io[port - 1] |= bit;
+	} else {
+		host_io[port - 1] &= ~bit;
+		if (mode == INPUT_PULLUP)	{ host_io[port] |= bit; }
+		else						{ host_io[port] &= ~bit; }
+	}
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if (pin >= sizeof(pin_map)) { return; }
+	uint8_t port = port_addr[pin_map[pin] >> 4];
+	uint8_t bit = (1 << (pin_map[pin] & 0x07));
+
+	if (val)	{ host_io[port] |= bit; }
+	else		{ host_io[port] &= ~bit; }
+}
+
+
+int digitalRead(uint8_t pin)
+{
+	if (pin >= sizeof(pin_map)) { return (LOW); }
+	uint8_t port = port_addr[pin_map[pin] >> 4];
+	uint8_t bit = (1 << (pin_map[pin] & 0x07));
+
+	return ((host_io[port - 2] & bit) ? HIGH : LOW);
+}
+
+
+unsigned long millis()
+{
+	return ((unsigned long)(host_cycles / (F_CPU / 1000UL)));
+}
+
+
+unsigned long micros()
+{
+	return ((unsigned long)(host_cycles / (F_CPU / 1000000UL)));
+}
+
+
+void delay(unsigned long ms)
+{
+	while (ms--) {
+		host_run_cycles(F_CPU / 1000UL);
+	}
+}
+
+
+void delayMicroseconds(unsigned int us)
+{
+	host_run_cycles(us * (F_CPU / 1000000UL));
+}
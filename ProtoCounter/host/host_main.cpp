@@ -0,0 +1,39 @@
+/*
+ * host_main.cpp
+ *
+ * main() for running an Arduino sketch in the host simulation.
+ * Timer0 is configured like the Arduino core does it (fast pwm, prescaler 64),
+ * then setup() and loop() are called. Every pass of loop() costs
+ * HOST_LOOP_CYCLES simulated cpu cycles.
+ *
+ * usage: <program> [simulated run time in milliseconds]
+ * Without an argument the sketch runs forever.
+ */
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "Arduino.h"
+
+#define HOST_LOOP_CYCLES	100
+
+int main(int argc, char* argv[])
+{
+	uint64_t run_cycles = 0;
+
+	if (argc > 1) {
+		run_cycles = (uint64_t)strtoul(argv[1], 0, 10) * (F_CPU / 1000UL);
+	}
+
+	host_reset();
+	TCCR0A = (1<<WGM01)|(1<<WGM00);		// fast pwm
+	TCCR0B = (1<<CS01)|(1<<CS00);		// prescaler 1:64
+	sei();
+
+	setup();
+	while ((run_cycles == 0) || (host_cycles < run_cycles)) {
+		loop();
+		host_run_cycles(HOST_LOOP_CYCLES);
+	}
+	return (0);
+}
@@ -0,0 +1,29 @@
+/*
+ * util/atomic.h
+ *
+ * Host replacement for <util/atomic.h>
+ * Same construction as in avr-libc: the interrupt state is restored by a
+ * cleanup function when the block is left.
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H_
+#define HOST_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static inline void __iSeiParam(const uint8_t *__s)		{ sei(); (void)__s; }
+static inline void __iCliParam(const uint8_t *__s)		{ cli(); (void)__s; }
+static inline void __iRestore(const uint8_t *__s)		{ SREG = *__s; }
+static inline uint8_t __iCliRetVal(void)				{ cli(); return 1; }
+static inline uint8_t __iSeiRetVal(void)				{ sei(); return 1; }
+
+#define ATOMIC_BLOCK(type)		for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+#define NONATOMIC_BLOCK(type)	for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE		uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON			uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE	uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF		uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif /* HOST_UTIL_ATOMIC_H_ */
@@ -0,0 +1,16 @@
+/*
+ * util/delay.h
+ *
+ * Host replacement for <util/delay.h>
+ * Delays advance the simulated time instead of burning host cpu time.
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <avr/io.h>
+
+static inline void _delay_us(double us)	{ host_run_cycles((uint32_t)(us * (F_CPU / 1000000UL))); }
+static inline void _delay_ms(double ms)	{ host_run_cycles((uint32_t)(ms * (F_CPU / 1000UL))); }
+
+#endif /* HOST_UTIL_DELAY_H_ */